@@ -0,0 +1,668 @@
+// Mikrobenchmarki modelu propagacji i silnika scenariuszy. Silnik pochodzi z wban-jamming.cc
+// (dołączonego bez main()), więc mierzony jest dokładnie ten sam kod co w symulatorze.
+// Nazwy benchmarków są stałe; wynik JSON (--out) służy do porównań przed/po zmianach.
+#define WBAN_JAMMING_NO_MAIN
+#include "wban-jamming.cc"
+
+#include <unordered_set>
+
+namespace
+{
+
+struct BenchResult
+{
+    std::string name;
+    uint64_t iterations = 0;   //!< operacji w jednym powtórzeniu
+    uint32_t repetitions = 0;
+    double nsPerOp = 0.0;      //!< mediana z powtórzeń
+    double nsPerOpMin = 0.0;
+    double itemsPerOp = 0.0;   //!< np. pakiety albo punkty na operację (0 = brak)
+    std::string itemName;
+};
+
+struct BenchOptions
+{
+    double minTime = 0.2;       //!< minimalny czas jednego powtórzenia (s)
+    uint32_t repetitions = 5;
+    std::string filter;         //!< podciąg nazwy; puste = wszystkie
+    std::vector<BenchResult> results;
+};
+
+bool
+IsSelected(const BenchOptions& options, const std::string& name)
+{
+    return options.filter.empty() || name.find(options.filter) != std::string::npos;
+}
+
+// op(n) wykonuje n operacji. Liczbę operacji dobieramy tak, by powtórzenie trwało co najmniej
+// minTime (kalibracja służy też za rozgrzewkę), a raportujemy medianę i minimum z powtórzeń.
+template <class Op>
+void
+Measure(BenchOptions& options,
+        const std::string& name,
+        double itemsPerOp,
+        const char* itemName,
+        Op&& op)
+{
+    if (!IsSelected(options, name))
+    {
+        return;
+    }
+
+    uint64_t n = 1;
+    while (true)
+    {
+        ProfileSample begin = ProfileSample::Now();
+        op(n);
+        double elapsed = ProfileSample::Now().wallSec - begin.wallSec;
+        if (elapsed >= options.minTime || n >= (uint64_t{1} << 40))
+        {
+            break;
+        }
+        uint64_t scaled = elapsed > 0.0 ? static_cast<uint64_t>(n * options.minTime / elapsed * 1.2) : 0;
+        n = std::max(n * 2, scaled);
+    }
+
+    std::vector<double> nsPerOp;
+    for (uint32_t r = 0; r < options.repetitions; ++r)
+    {
+        ProfileSample begin = ProfileSample::Now();
+        op(n);
+        nsPerOp.push_back((ProfileSample::Now().wallSec - begin.wallSec) * 1e9 / n);
+    }
+    std::sort(nsPerOp.begin(), nsPerOp.end());
+
+    BenchResult result;
+    result.name = name;
+    result.iterations = n;
+    result.repetitions = options.repetitions;
+    result.nsPerOp = nsPerOp[nsPerOp.size() / 2];
+    result.nsPerOpMin = nsPerOp.front();
+    result.itemsPerOp = itemsPerOp;
+    result.itemName = itemName ? itemName : "";
+    std::cout << "[Bench] " << name << ": " << result.nsPerOp << " ns/op (min " << result.nsPerOpMin << ")";
+    if (itemsPerOp > 0.0)
+    {
+        std::cout << ", " << itemsPerOp * 1e9 / result.nsPerOp << " " << result.itemName << "/s";
+    }
+    std::cout << std::endl;
+    options.results.push_back(result);
+}
+
+// Zapobiega usunięciu przez kompilator wywołań, których wynik nie jest używany.
+volatile double g_benchSink = 0.0;
+
+// Tłumienie ciała liczone jak przed zapamiętaniem m_bodyLossDb: wzór z DoCalcRxPower() wprost
+// z wiersza tabeli dielektrycznej przy każdym wywołaniu.
+double
+PerCallBodyLossDb(const BodyDielectricParameters& p, uint32_t fatLayer, uint32_t muscleLayer)
+{
+    double organDb = (520.8 * M_PI * p.organConductivity) / pow(p.organPermittivity, 0.5) * p.organThickness;
+    double muscleDb = (520.8 * M_PI * p.muscleConductivity) / pow(p.musclePermittivity, 0.5) * p.muscleThickness *
+                      p.muscleLayer * muscleLayer;
+    double fatDb = (520.8 * M_PI * p.fatConductivity) / pow(p.fatPermittivity, 0.5) * p.fatThickness * p.fatLayer *
+                   fatLayer;
+    double skinDb = (520.8 * M_PI * p.skinConductivity) / pow(p.skinPermittivity, 0.5) * p.skinThickness;
+    return organDb + skinDb + fatDb + muscleDb;
+}
+
+// Organ z pliku tkanek z kilkoma warstwami mięśni i tłuszczu (warstwa w pliku liczy się raz).
+const char* const kBenchTissueFile = "tissue heart point 300 0.93 67.0\n"
+                                     "tissue heart point 500 1.02 64.6\n"
+                                     "tissue muscle point 300 0.76 58.2\n"
+                                     "tissue muscle point 500 0.83 56.4\n"
+                                     "tissue fat point 300 0.039 5.6\n"
+                                     "tissue fat point 500 0.043 5.5\n"
+                                     "tissue skin point 300 0.65 47.9\n"
+                                     "tissue skin point 500 0.72 45.9\n"
+                                     "layer muscle 0.012\n"
+                                     "layer fat 0.046\n"
+                                     "layer skin 0.0013\n"
+                                     "organ bench-heart heart 0.01 3 2 1\n";
+
+// Dodaje organ bench-heart-402 z kBenchTissueFile. reference dostaje wiersz z wyrazami jednej
+// warstwy (liczby warstw 1), względem którego liczymy tłumienie per wywołanie.
+bool
+AddBenchTissueOrgan(BodyOrganOption& option, BodyDielectricParameters& reference)
+{
+    const fs::path path = fs::temp_directory_path() / "wban-jamming-bench-tissue.txt";
+    {
+        std::ofstream out(path, std::ios::out | std::ios::trunc);
+        out << kBenchTissueFile;
+    }
+    std::string error;
+    const bool loaded = GetTissueDatabase().Load(path.string(), error);
+    std::error_code ec;
+    fs::remove(path, ec);
+    if (!loaded || !LookupTissueOrganOption("bench-heart-402", option))
+    {
+        std::cerr << "[Check] BodyLossCache: nie można dodać organu z pliku tkanek: " << error << std::endl;
+        return false;
+    }
+    reference = BodyPropagationLossModel::GetDielectricParameters(option);
+    reference.muscleLayer = 1;
+    reference.fatLayer = 1;
+    return true;
+}
+
+// Zapamiętane m_bodyLossDb musi dawać bit w bit tę samą moc co obliczenie przy każdym wywołaniu,
+// dla wszystkich wbudowanych organów i organu z pliku tkanek, liczb warstw 0-6 i kilku mocy
+// nadawania. Dla organu z pliku sprawdzamy też liczby warstw ustawione przez SetBodyOptions().
+bool
+CheckBodyLossCache(SimulationContext& ctx)
+{
+    uint32_t checked = 0;
+    uint32_t mismatches = 0;
+    std::vector<std::pair<BodyOrganOption, BodyDielectricParameters>> organs;
+    for (uint32_t option = 0; option < BodyPropagationLossModel::BUILTIN_BODY_OPTIONS; ++option)
+    {
+        const auto organ = static_cast<BodyOrganOption>(option);
+        organs.emplace_back(organ, BodyPropagationLossModel::GetDielectricParameters(organ));
+    }
+    BodyOrganOption tissueOrgan;
+    BodyDielectricParameters tissueReference;
+    if (!AddBenchTissueOrgan(tissueOrgan, tissueReference))
+    {
+        return false;
+    }
+    organs.emplace_back(tissueOrgan, tissueReference);
+
+    ctx.bodyLoss->SetBodyOptions(tissueOrgan);
+    const double fileLossDb = PerCallBodyLossDb(tissueReference, 2, 3);
+    ++checked;
+    if (ctx.bodyLoss->GetFatLayer() != 2 || ctx.bodyLoss->GetMuscleLayer() != 3 ||
+        ctx.bodyLoss->GetBodyLossDb() != fileLossDb)
+    {
+        ++mismatches;
+        std::cerr << "[Check] BodyLossCache: organ=bench-heart-402 z warstwami z pliku (fat=2, muscle=3): "
+                  << std::setprecision(17) << ctx.bodyLoss->GetBodyLossDb() << " != " << fileLossDb << std::endl;
+    }
+
+    for (const auto& [organ, row] : organs)
+    {
+        ctx.bodyLoss->SetBodyOptions(organ);
+        for (uint32_t fatLayer = 0; fatLayer <= 6; ++fatLayer)
+        {
+            for (uint32_t muscleLayer = 0; muscleLayer <= 6; ++muscleLayer)
+            {
+                ctx.bodyLoss->SetFatLayer(fatLayer);
+                ctx.bodyLoss->SetMuscleLayer(muscleLayer);
+                for (double txPowerDbm : {-20.0, -16.0, 0.0})
+                {
+                    const double cached = ctx.bodyLoss->CalcRxPower(txPowerDbm, ctx.mTx, ctx.mRx);
+                    const double perCall = txPowerDbm - PerCallBodyLossDb(row, fatLayer, muscleLayer);
+                    // PrepareScenario liczy budżet łącza przez GetLinkBodyLossDb() zamiast CalcRxPower()
+                    const double mean = txPowerDbm - ctx.bodyLoss->GetLinkBodyLossDb(ctx.mTx, ctx.mRx);
+                    ++checked;
+                    if (cached != perCall || mean != perCall)
+                    {
+                        ++mismatches;
+                        std::cerr << "[Check] BodyLossCache: organ=" << BodyOrganOptionToString(organ)
+                                  << " fat=" << fatLayer << " muscle=" << muscleLayer << " tx=" << txPowerDbm
+                                  << ": " << std::setprecision(17) << cached << " != " << perCall << std::endl;
+                    }
+                }
+            }
+        }
+    }
+    // stan jak po CreateSimulationContext()
+    ctx.bodyLoss->SetBodyOptions(BodyOrganOption::HEART_402_MHZ);
+    std::cout << "[Check] BodyLossCache: " << checked << " porównań, " << mismatches << " niezgodności"
+              << std::endl;
+    return mismatches == 0;
+}
+
+// Każde jądro BatchLinkBudget obsługiwane przez CPU musi zgadzać się z łańcuchem
+// pathLoss -> bodyLoss liczonym per wywołanie z dokładnością TOLERANCE_DB, dla łączy przez ciało
+// (TX zarejestrowany w ciele, bodyLossDb z modelu) i poza nim (jammer, bodyLossDb = 0), w obu
+// wariantach CalcRxPower (pary i wspólny odbiornik). Odległości obejmują też punkty poniżej
+// odległości referencyjnej LogDistance.
+bool
+CheckBatchLinkBudget(SimulationContext& ctx)
+{
+    const size_t pairs = 1001;
+    std::vector<double> ax(pairs), ay(pairs), az(pairs), bx(pairs, 0.3), by(pairs, 0.0), bz(pairs, 0.0);
+    for (size_t i = 0; i < pairs; ++i)
+    {
+        const double distance = 0.01 * std::pow(10.0, 5.0 * i / (pairs - 1)); // 1 cm .. 1 km
+        const double angle = 0.7 * i;
+        ax[i] = 0.3 + distance * std::cos(angle);
+        ay[i] = distance * std::sin(angle);
+        az[i] = (i % 3) * 0.1;
+    }
+    const double txPowerDbm = ctx.parameters.txPowerDbm;
+    const char* names[] = {"scalar", "avx2", "avx512"};
+    uint32_t checked = 0;
+    uint32_t mismatches = 0;
+    double maxError = 0.0;
+    for (bool inBody : {true, false})
+    {
+        Ptr<ConstantPositionMobilityModel> a = inBody ? ctx.mTx : ctx.mJam;
+        std::vector<double> perCall(pairs);
+        for (size_t i = 0; i < pairs; ++i)
+        {
+            a->SetPosition(Vector(ax[i], ay[i], az[i]));
+            ctx.mRx->SetPosition(Vector(bx[i], by[i], bz[i]));
+            perCall[i] = ctx.pathLoss->CalcRxPower(txPowerDbm, a, ctx.mRx);
+        }
+        BatchLinkBudget batch(ctx.pathLoss, inBody ? ctx.bodyLoss->GetBodyLossDb() : 0.0);
+        for (auto kernel : {BatchLinkBudget::Kernel::SCALAR,
+                            BatchLinkBudget::Kernel::AVX2,
+                            BatchLinkBudget::Kernel::AVX512})
+        {
+            if (kernel > BatchLinkBudget::GetBestKernel())
+            {
+                continue;
+            }
+            batch.SetKernel(kernel);
+            std::vector<double> pairOut(pairs);
+            std::vector<double> receiverOut(pairs);
+            batch.CalcRxPower(txPowerDbm,
+                              PositionArrays{ax.data(), ay.data(), az.data()},
+                              PositionArrays{bx.data(), by.data(), bz.data()},
+                              pairs,
+                              pairOut.data());
+            batch.CalcRxPower(txPowerDbm,
+                              PositionArrays{ax.data(), ay.data(), az.data()},
+                              Vector(bx[0], by[0], bz[0]),
+                              pairs,
+                              receiverOut.data());
+            for (size_t i = 0; i < pairs; ++i)
+            {
+                for (double value : {pairOut[i], receiverOut[i]})
+                {
+                    const double error = std::abs(value - perCall[i]);
+                    maxError = std::max(maxError, error);
+                    ++checked;
+                    if (!(error <= BatchLinkBudget::TOLERANCE_DB))
+                    {
+                        ++mismatches;
+                        std::cerr << "[Check] BatchLinkBudget: kernel=" << names[static_cast<int>(kernel)]
+                                  << (inBody ? " link=inBody" : " link=outside") << " a=(" << ax[i] << ", "
+                                  << ay[i] << ", " << az[i] << "): " << std::setprecision(17) << value
+                                  << " vs " << perCall[i] << std::endl;
+                    }
+                }
+            }
+        }
+    }
+    std::cout << "[Check] BatchLinkBudget: " << checked << " porównań, " << mismatches
+              << " niezgodności, największa różnica " << maxError << " dB (tolerancja "
+              << BatchLinkBudget::TOLERANCE_DB << " dB)" << std::endl;
+    return mismatches == 0;
+}
+
+void
+BenchCalcRxPower(BenchOptions& options, SimulationContext& ctx)
+{
+    std::vector<BodyOrganOption> organs;
+    ParseBodyOrganList("all", organs);
+    ctx.mTx->SetPosition(Vector(0.0, 0.0, 0.0));
+    ctx.mRx->SetPosition(Vector(0.3, 0.0, 0.0));
+    for (BodyOrganOption organ : organs)
+    {
+        ctx.bodyLoss->SetBodyOptions(organ);
+        Measure(options,
+                std::string("CalcRxPower/organ=") + BodyOrganOptionToString(organ),
+                0.0,
+                nullptr,
+                [&ctx](uint64_t n) {
+                    double sum = 0.0;
+                    for (uint64_t i = 0; i < n; ++i)
+                    {
+                        sum += ctx.bodyLoss->CalcRxPower(ctx.parameters.txPowerDbm, ctx.mTx, ctx.mRx);
+                    }
+                    g_benchSink = sum;
+                });
+    }
+}
+
+// Poprzedni test przynależności do ciała (std::unordered_set, do dwóch wyszukiwań na wywołanie)
+// w modelu o tej samej ścieżce wywołania co BodyPropagationLossModel: punkt odniesienia
+// ShouldApplyBodyLoss/reference=unordered_set.
+class UnorderedSetBodyLossModel : public PropagationLossModel
+{
+  public:
+    void SetBodyLossDb(double bodyLossDb) { m_bodyLossDb = bodyLossDb; }
+    void AddBodyMobility(Ptr<MobilityModel> mobility) { m_bodyMobility.insert(PeekPointer(mobility)); }
+    void ClearBodyMobility() { m_bodyMobility.clear(); }
+
+  private:
+    double DoCalcRxPower(double txPowerDbm, Ptr<MobilityModel> a, Ptr<MobilityModel> b) const override
+    {
+        const bool apply = m_bodyMobility.empty() ||
+                           m_bodyMobility.find(PeekPointer(a)) != m_bodyMobility.end() ||
+                           m_bodyMobility.find(PeekPointer(b)) != m_bodyMobility.end();
+        return apply ? txPowerDbm - m_bodyLossDb : txPowerDbm;
+    }
+
+    int64_t DoAssignStreams(int64_t) override { return 0; }
+
+    double m_bodyLossDb = 0.0;
+    std::unordered_set<const MobilityModel*> m_bodyMobility;
+};
+
+// ShouldApplyBodyLoss() jest prywatne, więc mierzymy je przez CalcRxPower(): różnica względem
+// selective=off to koszt testu przynależności (link=inBody: TX w ciele, link=outside: JAM -> RX).
+// Te same łącza liczy model odniesienia z std::unordered_set (reference=unordered_set).
+void
+BenchShouldApplyBodyLoss(BenchOptions& options, SimulationContext& ctx)
+{
+    ctx.bodyLoss->SetBodyOptions(BodyOrganOption::HEART_402_MHZ);
+    ctx.mTx->SetPosition(Vector(0.0, 0.0, 0.0));
+    ctx.mRx->SetPosition(Vector(0.3, 0.0, 0.0));
+    ctx.mJam->SetPosition(Vector(5.0, 0.0, 0.0));
+
+    Ptr<UnorderedSetBodyLossModel> reference = CreateObject<UnorderedSetBodyLossModel>();
+    reference->SetBodyLossDb(ctx.bodyLoss->GetBodyLossDb());
+    auto measureLink = [&](const std::string& name,
+                           Ptr<PropagationLossModel> model,
+                           Ptr<MobilityModel> a,
+                           Ptr<MobilityModel> b) {
+        Measure(options, name, 0.0, nullptr, [&ctx, model, a, b](uint64_t n) {
+            double sum = 0.0;
+            for (uint64_t i = 0; i < n; ++i)
+            {
+                sum += model->CalcRxPower(ctx.parameters.txPowerDbm, a, b);
+            }
+            g_benchSink = sum;
+        });
+    };
+
+    ctx.bodyLoss->ClearBodyMobility();
+    measureLink("ShouldApplyBodyLoss/selective=off", ctx.bodyLoss, ctx.mTx, ctx.mRx);
+
+    std::vector<Ptr<MobilityModel>> extra;
+    for (uint32_t registered : {1u, 10u, 1024u})
+    {
+        ctx.bodyLoss->ClearBodyMobility();
+        ctx.bodyLoss->AddBodyMobility(ctx.mTx);
+        reference->ClearBodyMobility();
+        reference->AddBodyMobility(ctx.mTx);
+        while (extra.size() + 1 < registered)
+        {
+            extra.push_back(CreateObject<ConstantPositionMobilityModel>());
+        }
+        for (size_t i = 0; i + 1 < registered; ++i)
+        {
+            ctx.bodyLoss->AddBodyMobility(extra[i]);
+            reference->AddBodyMobility(extra[i]);
+        }
+        const std::string suffix = "/registered=" + std::to_string(registered);
+        measureLink("ShouldApplyBodyLoss/selective=on" + suffix + "/link=inBody", ctx.bodyLoss, ctx.mTx, ctx.mRx);
+        measureLink("ShouldApplyBodyLoss/selective=on" + suffix + "/link=outside", ctx.bodyLoss, ctx.mJam, ctx.mRx);
+        measureLink("ShouldApplyBodyLoss/reference=unordered_set" + suffix + "/link=inBody",
+                    reference,
+                    ctx.mTx,
+                    ctx.mRx);
+        measureLink("ShouldApplyBodyLoss/reference=unordered_set" + suffix + "/link=outside",
+                    reference,
+                    ctx.mJam,
+                    ctx.mRx);
+    }
+
+    // stan jak po CreateSimulationContext()
+    ctx.bodyLoss->ClearBodyMobility();
+    ctx.bodyLoss->AddBodyMobility(ctx.mTx);
+}
+
+void
+BenchBatchLinkBudget(BenchOptions& options, SimulationContext& ctx)
+{
+    const size_t pairs = 4096;
+    std::vector<double> x(pairs), y(pairs, 0.0), z(pairs, 0.0), out(pairs);
+    for (size_t i = 0; i < pairs; ++i)
+    {
+        x[i] = 0.5 + 0.01 * i;
+    }
+    const char* names[] = {"scalar", "avx2", "avx512"};
+    BatchLinkBudget batch(ctx.pathLoss, ctx.bodyLoss->GetBodyLossDb());
+    for (auto kernel : {BatchLinkBudget::Kernel::SCALAR,
+                        BatchLinkBudget::Kernel::AVX2,
+                        BatchLinkBudget::Kernel::AVX512})
+    {
+        if (kernel > BatchLinkBudget::GetBestKernel())
+        {
+            continue;
+        }
+        batch.SetKernel(kernel);
+        Measure(options,
+                std::string("BatchLinkBudget/kernel=") + names[static_cast<int>(kernel)] +
+                    "/pairs=" + std::to_string(pairs),
+                static_cast<double>(pairs),
+                "pairs",
+                [&](uint64_t n) {
+                    for (uint64_t i = 0; i < n; ++i)
+                    {
+                        batch.CalcRxPower(ctx.parameters.txPowerDbm,
+                                          PositionArrays{x.data(), y.data(), z.data()},
+                                          Vector(0.3, 0.0, 0.0),
+                                          pairs,
+                                          out.data());
+                    }
+                    g_benchSink = out[pairs / 2];
+                });
+    }
+}
+
+// Pojedynczy punkt: obie fazy pakietowe, bez pamięci fazy 1 i bez earlyStop.
+void
+BenchRunScenario(BenchOptions& options, SimulationContext& ctx)
+{
+    const uint32_t savedNoJam = ctx.parameters.noJamPackets;
+    const uint32_t savedWithJam = ctx.parameters.withJamPackets;
+    const bool savedReuse = ctx.parameters.reuseNoJamPhase;
+    ctx.parameters.reuseNoJamPhase = false;
+
+    SimulationConfig config{0.0, 0.0, 0.3, 0.0, 43.0, 0.0, BodyOrganOption::HEART_402_MHZ};
+    for (uint32_t packets : {100u, 1000u, 5000u})
+    {
+        ctx.parameters.noJamPackets = packets;
+        ctx.parameters.withJamPackets = packets;
+        Measure(options,
+                "RunScenario/packets=" + std::to_string(packets),
+                3.0 * packets,
+                "packets",
+                [&](uint64_t n) {
+                    for (uint64_t i = 0; i < n; ++i)
+                    {
+                        g_benchSink = RunScenario(ctx, config, false).jamRxTx;
+                    }
+                });
+    }
+
+    ctx.parameters.noJamPackets = savedNoJam;
+    ctx.parameters.withJamPackets = savedWithJam;
+    ctx.parameters.reuseNoJamPhase = savedReuse;
+}
+
+// Cały skan jammera przez RunScenarioBatch(); pamięci podręczne kontekstu czyścimy przed
+// każdym przebiegiem, żeby powtórzenia były porównywalne.
+void
+BenchSweep(BenchOptions& options, SimulationContext& ctx, uint32_t points, uint32_t packets, uint32_t jobs)
+{
+    const uint32_t savedNoJam = ctx.parameters.noJamPackets;
+    const uint32_t savedWithJam = ctx.parameters.withJamPackets;
+    ctx.parameters.noJamPackets = packets;
+    ctx.parameters.withJamPackets = packets;
+
+    SimulationConfig baseConfig{0.0, 0.0, 0.3, 0.0, 43.0, 0.0, BodyOrganOption::HEART_402_MHZ};
+    std::vector<SimulationConfig> configs;
+    const double step = 120.0 / std::max(1u, points - 1);
+    for (uint32_t i = 0; i < points; ++i)
+    {
+        configs.push_back(MakeScanConfig(baseConfig, true, -60.0 + i * step));
+    }
+
+    for (FastPathMode fastPath : {FastPathMode::OFF, FastPathMode::ON})
+    {
+        SweepOptions sweep;
+        sweep.jobs = jobs;
+        sweep.fastPath = fastPath;
+        std::string name = "Sweep/target=jam/points=" + std::to_string(points) +
+                           "/packets=" + std::to_string(packets) +
+                           "/fastPath=" + (fastPath == FastPathMode::ON ? "on" : "off") +
+                           "/jobs=" + std::to_string(jobs);
+        Measure(options, name, points, "points", [&](uint64_t n) {
+            std::vector<SimulationResult> results;
+            for (uint64_t i = 0; i < n; ++i)
+            {
+                ctx.noJamCache.clear();
+                ctx.dedupCache.clear();
+                if (!RunScenarioBatch(ctx, configs, sweep, results))
+                {
+                    NS_FATAL_ERROR("[Bench] RunScenarioBatch nie powiódł się");
+                }
+            }
+            g_benchSink = results.empty() ? 0.0 : results.back().jamRxTx;
+        });
+    }
+
+    ctx.parameters.noJamPackets = savedNoJam;
+    ctx.parameters.withJamPackets = savedWithJam;
+}
+
+// Scenariusz oddziału (--bans) dla N = 10, 100 i 1000 na kanale WardSpectrumChannel. Każde
+// powtórzenie buduje świeży kontekst i oddział, a po przebiegu czyści symulator. Odcięcie -90 dBm
+// przy odstępie 3 m daje zasięg kilku metrów, więc liczba sąsiadów nie rośnie z N i czas na BAN
+// powinien być prawie stały; wiersz [Bench] podaje też zdarzenia i sprawdzenia odległości na BAN.
+void
+BenchWard(BenchOptions& options, uint32_t packets)
+{
+    ScenarioParameters parameters;
+    parameters.noJamPackets = packets;
+    parameters.withJamPackets = packets;
+    SimulationConfig baseConfig{0.0, 0.0, 0.3, 0.0, 43.0, 0.0, BodyOrganOption::HEART_402_MHZ};
+    for (uint32_t bans : {10u, 100u, 1000u})
+    {
+        const std::string name = "Ward/bans=" + std::to_string(bans);
+        if (!IsSelected(options, name))
+        {
+            continue;
+        }
+        WardOptions ward;
+        ward.bans = bans;
+        ward.spacing = 3.0;
+        ward.cutoffDbm = -90.0;
+        uint64_t events = 0;
+        uint64_t checked = 0;
+        Measure(options, name, bans, "BAN", [&](uint64_t n) {
+            for (uint64_t i = 0; i < n; ++i)
+            {
+                std::unique_ptr<SimulationContext> context =
+                    CreateSimulationContext(BodyOrganOption::HEART_402_MHZ, parameters);
+                std::unique_ptr<WardScenario> scenario = CreateWardScenario(*context, baseConfig, ward);
+                RunWardScenario(*scenario, false);
+                events = scenario->events;
+                checked = scenario->channel->GetChecked();
+                scenario.reset();
+                context.reset();
+                Simulator::Destroy();
+            }
+        });
+        std::cout << "[Bench] " << name << ": " << static_cast<double>(events) / bans << " zdarzeń na BAN, "
+                  << static_cast<double>(checked) / bans << " sprawdzeń odległości na BAN" << std::endl;
+    }
+}
+
+bool
+WriteBenchJson(const std::string& out, const BenchOptions& options, uint32_t jobs)
+{
+    fs::path path = ResolveCsvPath(out);
+    std::error_code ec;
+    if (!path.parent_path().empty())
+    {
+        fs::create_directories(path.parent_path(), ec);
+    }
+    std::ofstream file(path, std::ios::out | std::ios::trunc);
+    if (ec || !file.is_open())
+    {
+        std::cerr << "[Bench] Nie można zapisać wyników do '" << path.string() << "'" << std::endl;
+        return false;
+    }
+    file << std::setprecision(9);
+    file << "{\n  \"context\": {\"minTimeSec\": " << options.minTime << ", \"repetitions\": " << options.repetitions
+         << ", \"jobs\": " << jobs << ", \"hardwareConcurrency\": " << std::thread::hardware_concurrency()
+         << "},\n  \"benchmarks\": [";
+    for (size_t i = 0; i < options.results.size(); ++i)
+    {
+        const BenchResult& r = options.results[i];
+        file << (i ? ",\n" : "\n") << "    {\"name\": \"" << r.name << "\", \"iterations\": " << r.iterations
+             << ", \"repetitions\": " << r.repetitions << ", \"nsPerOp\": " << r.nsPerOp
+             << ", \"nsPerOpMin\": " << r.nsPerOpMin;
+        if (r.itemsPerOp > 0.0)
+        {
+            file << ", \"items\": \"" << r.itemName << "\", \"itemsPerSec\": " << r.itemsPerOp * 1e9 / r.nsPerOp;
+        }
+        file << "}";
+    }
+    file << (options.results.empty() ? "]\n}\n" : "\n  ]\n}\n");
+    file.close();
+    if (file.fail())
+    {
+        std::cerr << "[Bench] Błąd zapisu do '" << path.string() << "'" << std::endl;
+        return false;
+    }
+    std::cout << "[Bench] Wyniki zapisano do " << path.string() << std::endl;
+    return true;
+}
+
+} // namespace
+
+int
+main(int argc, char* argv[])
+{
+    BenchOptions options;
+    std::string out;
+    uint32_t sweepPoints = 241;
+    uint32_t sweepPackets = 100;
+    uint32_t wardPackets = 20;
+    uint32_t jobs = 1;
+
+    CommandLine cmd;
+    cmd.AddValue("out", "Plik JSON z wynikami (ścieżka jak dla --scanCsv; puste = tylko konsola)", out);
+    cmd.AddValue("filter", "Uruchom tylko benchmarki, których nazwa zawiera ten napis", options.filter);
+    cmd.AddValue("minTime", "Minimalny czas jednego powtórzenia (s)", options.minTime);
+    cmd.AddValue("repetitions", "Liczba powtórzeń (raportowana jest mediana i minimum)", options.repetitions);
+    cmd.AddValue("sweepPoints", "Liczba punktów skanu w benchmarku Sweep", sweepPoints);
+    cmd.AddValue("sweepPackets", "Pakiety na fazę w benchmarku Sweep", sweepPackets);
+    cmd.AddValue("wardPackets", "Pakiety na fazę w benchmarku Ward", wardPackets);
+    cmd.AddValue("jobs", "Liczba procesów-workerów w benchmarku Sweep (0 = liczba rdzeni)", jobs);
+    cmd.Parse(argc, argv);
+
+    if (options.repetitions == 0 || options.minTime < 0.0 || sweepPoints < 2 || sweepPackets == 0 ||
+        wardPackets == 0)
+    {
+        std::cerr << "[CLI] repetitions > 0, minTime >= 0, sweepPoints >= 2, sweepPackets > 0 i wardPackets > 0"
+                  << std::endl;
+        return 1;
+    }
+    if (jobs == 0)
+    {
+        jobs = std::max(1u, std::thread::hardware_concurrency());
+    }
+
+    std::unique_ptr<SimulationContext> context =
+        CreateSimulationContext(BodyOrganOption::HEART_402_MHZ, ScenarioParameters());
+    SimulationContext& ctx = *context;
+
+    if (!CheckBodyLossCache(ctx) || !CheckBatchLinkBudget(ctx))
+    {
+        return 1;
+    }
+
+    BenchCalcRxPower(options, ctx);
+    BenchShouldApplyBodyLoss(options, ctx);
+    BenchBatchLinkBudget(options, ctx);
+    BenchRunScenario(options, ctx);
+    BenchSweep(options, ctx, sweepPoints, sweepPackets, jobs);
+    context.reset();
+    BenchWard(options, wardPackets);
+
+    if (!out.empty() && !WriteBenchJson(out, options, jobs))
+    {
+        return 1;
+    }
+    Simulator::Destroy();
+    return 0;
+}
@@ -5,14 +5,66 @@
 #include "ns3/wban-module.h"
 
 #include <algorithm>
+#include <array>
+#include <charconv>
+#include <condition_variable>
+#include <deque>
 #include <filesystem>
 #include <cctype>
 #include <cmath>
+#include <cstddef>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
 #include <fstream>
+#include <functional>
+#include <iomanip>
 #include <limits>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <numeric>
+#include <sstream>
 #include <string>
+#include <thread>
+#include <type_traits>
 #include <unordered_map>
 #include <system_error>
+#include <vector>
+
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+// Licznik alokacji sterty wątku (każdy worker --jobs ma własny). RunScenario odczytuje go
+// wokół Simulator::Run(), więc raport [Packets] podaje zmierzone alokacje fazy pakietowej
+// wątku symulacji, bez alokacji wątku zapisu CsvSink działającego w tym czasie.
+static thread_local uint64_t t_heapAllocations = 0;
+
+void*
+operator new(std::size_t size)
+{
+    ++t_heapAllocations;
+    if (void* p = std::malloc(size ? size : 1))
+    {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+void
+operator delete(void* p) noexcept
+{
+    std::free(p);
+}
+
+void
+operator delete(void* p, std::size_t) noexcept
+{
+    std::free(p);
+}
 
 using namespace ns3;
 using namespace ns3::wban;
@@ -53,8 +105,63 @@ ToLower(std::string value)
     return value;
 }
 
-BodyOrganOption
-ParseBodyOrganOption(const std::string& organ)
+// --tissueFile: organy z bazy tkanek są dodawane do tabeli modelu propagacji przy pierwszym
+// użyciu nazwy "<organ>-<MHz>" i dalej wybierane przez BodyOrganOption jak organy wbudowane.
+// Tabela jest uzupełniana przed forkiem workerów, więc workery dziedziczą te same opcje.
+TissueDatabase&
+GetTissueDatabase()
+{
+    static TissueDatabase database;
+    return database;
+}
+
+// nazwy dodanych opcji, indeks = opcja - BUILTIN_BODY_OPTIONS (deque: c_str() pozostaje ważne)
+std::deque<std::string>&
+GetTissueOrganNames()
+{
+    static std::deque<std::string> names;
+    return names;
+}
+
+bool
+LookupTissueOrganOption(const std::string& organ, BodyOrganOption& option)
+{
+    std::deque<std::string>& names = GetTissueOrganNames();
+    auto known = std::find(names.begin(), names.end(), organ);
+    if (known != names.end())
+    {
+        option = static_cast<BodyOrganOption>(BodyPropagationLossModel::BUILTIN_BODY_OPTIONS +
+                                              (known - names.begin()));
+        return true;
+    }
+
+    size_t dash = organ.rfind('-');
+    if (dash == std::string::npos || !GetTissueDatabase().HasOrgan(organ.substr(0, dash)))
+    {
+        return false;
+    }
+    const char* first = organ.c_str() + dash + 1;
+    char* end = nullptr;
+    double frequencyMhz = std::strtod(first, &end);
+    if (end == first || *end != '\0' || !(frequencyMhz > 0.0))
+    {
+        return false;
+    }
+
+    BodyDielectricParameters parameters;
+    std::string error;
+    if (!GetTissueDatabase().Materialize(organ.substr(0, dash), frequencyMhz, parameters, error))
+    {
+        std::cerr << "[Tissue] " << organ << ": " << error << std::endl;
+        return false;
+    }
+    option = BodyPropagationLossModel::AddBodyOption(parameters);
+    names.push_back(organ);
+    return true;
+}
+
+bool
+LookupBodyOrganOption(const std::string& organ, BodyOrganOption& option)
 {
     static const std::unordered_map<std::string, BodyOrganOption> kOrganMap = {
         {"heart", BodyOrganOption::HEART_402_MHZ},
@@ -73,11 +180,22 @@ ParseBodyOrganOption(const std::string& organ)
         {"kidney-2400", BodyOrganOption::KIDNEY_2400_MHZ},
     };
 
-    auto key = ToLower(organ);
-    auto it = kOrganMap.find(key);
+    auto it = kOrganMap.find(ToLower(organ));
     if (it != kOrganMap.end())
     {
-        return it->second;
+        option = it->second;
+        return true;
+    }
+    return LookupTissueOrganOption(ToLower(organ), option);
+}
+
+BodyOrganOption
+ParseBodyOrganOption(const std::string& organ)
+{
+    BodyOrganOption option;
+    if (LookupBodyOrganOption(organ, option))
+    {
+        return option;
     }
 
     std::cout << "[WBAN] Nieznana opcja organu '" << organ
@@ -85,7 +203,7 @@ ParseBodyOrganOption(const std::string& organ)
     return BodyOrganOption::HEART_402_MHZ;
 }
 
-std::string
+const char*
 BodyOrganOptionToString(BodyOrganOption option)
 {
     switch (option)
@@ -117,9 +235,67 @@ BodyOrganOptionToString(BodyOrganOption option)
     case BodyOrganOption::KIDNEY_402_MHZ:
         return "kidney-402";
     }
+    auto index = static_cast<uint32_t>(option);
+    const std::deque<std::string>& names = GetTissueOrganNames();
+    if (index >= BodyPropagationLossModel::BUILTIN_BODY_OPTIONS &&
+        index - BodyPropagationLossModel::BUILTIN_BODY_OPTIONS < names.size())
+    {
+        return names[index - BodyPropagationLossModel::BUILTIN_BODY_OPTIONS].c_str();
+    }
     return "unknown";
 }
 
+// --bodyOrgan: pojedyncza nazwa (nieznana -> heart-402 jak dotąd), lista po przecinku albo
+// "all". Na liście nieznana nazwa jest błędem, a powtórzenia są pomijane.
+bool
+ParseBodyOrganList(const std::string& value, std::vector<BodyOrganOption>& organs)
+{
+    organs.clear();
+    if (ToLower(value) == "all")
+    {
+        organs = {BodyOrganOption::HEART_402_MHZ,
+                  BodyOrganOption::HEART_2400_MHZ,
+                  BodyOrganOption::KIDNEY_402_MHZ,
+                  BodyOrganOption::KIDNEY_2400_MHZ,
+                  BodyOrganOption::SMALL_INTESTINE_402_MHZ,
+                  BodyOrganOption::SMALL_INTESTINE_916_5_MHZ,
+                  BodyOrganOption::SMALL_INTESTINE_2400_MHZ,
+                  BodyOrganOption::LARGE_INTESTINE_2400_MHZ,
+                  BodyOrganOption::FAT_402_MHZ,
+                  BodyOrganOption::FAT_2400_MHZ,
+                  BodyOrganOption::SKIN_402_MHZ,
+                  BodyOrganOption::SKIN_863_MHZ,
+                  BodyOrganOption::SKIN_2400_MHZ};
+        return true;
+    }
+    if (value.find(',') == std::string::npos)
+    {
+        organs.push_back(ParseBodyOrganOption(value));
+        return true;
+    }
+
+    size_t begin = 0;
+    while (begin <= value.size())
+    {
+        size_t end = std::min(value.find(',', begin), value.size());
+        std::string name = value.substr(begin, end - begin);
+        name.erase(0, name.find_first_not_of(" \t"));
+        name.erase(name.find_last_not_of(" \t") + 1);
+        BodyOrganOption option;
+        if (!LookupBodyOrganOption(name, option))
+        {
+            std::cerr << "[CLI] Nieznany organ '" << name << "' na liście bodyOrgan" << std::endl;
+            return false;
+        }
+        if (std::find(organs.begin(), organs.end(), option) == organs.end())
+        {
+            organs.push_back(option);
+        }
+        begin = end + 1;
+    }
+    return true;
+}
+
 } // namespace
 
 //m_phyOption = WbanPhyOption::NB_402_MHZ_75_9;
@@ -133,6 +309,9 @@ struct SimulationConfig
     double jamX;
     double jamY;
     BodyOrganOption organOption;
+    double jamZ = 0.0;
+    uint32_t replication = 0; //!< --replications: numer niezależnej replikacji punktu
+    double jamBoostDb = 0.0;  //!< --jamBoostDb: moc jammera ponad txPowerDbm (dB)
 };
 
 struct SimulationResult
@@ -154,8 +333,459 @@ struct SimulationResult
     double rxY = 0.0;
     double jamX = 0.0;
     double jamY = 0.0;
+    double jamZ = 0.0;
+    BodyOrganOption organOption = BodyOrganOption::HEART_402_MHZ;
+    double jamBoostDb = 0.0;
+    bool analytic = false; //!< wiersz wyznaczony z budżetu łącza, bez symulacji pakietowej
+    uint32_t packetCopies = 0; //!< wysyłki jako kopie szablonów (Packet::Copy, bez nowego bufora i tagu)
+    uint64_t heapAllocations = 0; //!< alokacje sterty zmierzone w Simulator::Run()
+    uint32_t tagLookups = 0;   //!< odbiory, dla których źródło trzeba było odczytać z tagu
+    double noJamCiLow = 0.0;   //!< przedział Wilsona dla noJamSuccessRate (przy earlyStop)
+    double noJamCiHigh = 0.0;
+    double jamCiLow = 0.0;     //!< przedział Wilsona dla jamSuccessRate (przy earlyStop)
+    double jamCiHigh = 0.0;
+    bool noJamReused = false;  //!< faza 1 wzięta z pamięci podręcznej kontekstu
+    bool deduplicated = false; //!< liczniki skopiowane z punktu o tej samej sygnaturze odległości
+    double scheduleWallSec = 0.0; //!< --profile: przygotowanie punktu i planowanie zdarzeń
+    double scheduleCpuSec = 0.0;
+    double runWallSec = 0.0;      //!< --profile: Simulator::Run()
+    double runCpuSec = 0.0;
+    uint64_t events = 0;          //!< --profile: zdarzenia wykonane w Simulator::Run()
+    uint64_t eventQueuePeak = 0;  //!< --profile: największa liczba zdarzeń w kolejce
+    uint32_t activeJammers = 0;   //!< jammery z --jammerFile powyżej progu odcięcia u RX
+    uint32_t replications = 0;    //!< --replications: liczba replikacji uśrednionych w wierszu
+    double noJamRateMean = 0.0;   //!< średnia noJamSuccessRate po replikacjach
+    double noJamRateCiHalf = 0.0; //!< połowa szerokości przedziału ufności dla noJamRateMean
+    double jamRateMean = 0.0;     //!< średnia jamSuccessRate po replikacjach
+    double jamRateCiHalf = 0.0;   //!< połowa szerokości przedziału ufności dla jamRateMean
+};
+
+enum class FastPathMode
+{
+    OFF,      //!< każdy punkt liczony symulacją pakietową
+    ON,       //!< punkty o pewnym wyniku wyznaczane analitycznie
+    VALIDATE, //!< obie ścieżki, raport niezgodności
+};
+
+class ScanJournal;
+class ScanProfile;
+class ResultCache;
+class CsvSink;
+
+// Sekwencyjne zatrzymywanie faz: co `batch` wysłanych pakietów liczymy przedział Wilsona
+// skuteczności i kończymy fazę, gdy cały przedział leży po jednej stronie progu jamThreshold.
+struct EarlyStopOptions
+{
+    bool enabled = false;
+    double confidence = 0.99; //!< ufność decyzji fazy (łącznie dla wszystkich sprawdzeń)
+    uint32_t batch = 50;      //!< co ile wysłanych pakietów sprawdzamy przedział
+    double threshold = 0.05;  //!< próg isJammed (jamThreshold)
+    double noJamHalfWidth = 0.01; //!< faza 1: połowa szerokości przedziału, przy której kończymy
+};
+
+// Ustawienia wspólne dla wszystkich trybów skanowania.
+struct SweepOptions
+{
+    uint32_t jobs = 1;
+    FastPathMode fastPath = FastPathMode::OFF;
+    double fastPathMarginDb = 10.0;
+    ScanJournal* journal = nullptr;  //!< dziennik policzonych punktów (nullptr = bez dziennika)
+    ResultCache* cache = nullptr;    //!< trwała pamięć wyników między uruchomieniami (--cacheDir)
+    bool dedup = false;              //!< symuluj raz każdą sygnaturę odległości (--dedupScan)
+    bool organColumn = false;        //!< kolumna organ w CSV (--bodyOrgan z kilkoma organami)
+    uint32_t checkpointEvery = 0;    //!< co ile symulowanych punktów dopisywać i fsync-ować dziennik (0 = bez)
+};
+
+// Tryb --scanMode=power: dla każdej pozycji skanu najmniejsze wzmocnienie jammera z siatki
+// [minDb, maxDb] co stepDb, przy którym łącze jest zagłuszone.
+struct PowerSolverOptions
+{
+    double minDb = -20.0;
+    double maxDb = 40.0;
+    double stepDb = 0.5;
+};
+
+// Parametry skanu siatkowego (jamX, jamY[, jamZ]) z adaptacyjnym podziałem komórek.
+struct GridScanOptions
+{
+    double xStart;
+    double xStop;
+    double yStart;
+    double yStop;
+    double zStart;
+    double zStop;
+    double step;     //!< rozdzielczość najdrobniejszej komórki (m)
+    uint32_t levels; //!< liczba podziałów: komórka zgrubna ma bok step * 2^levels
+};
+
+// Tryb trajektorii: ruchomy węzeł (jammer albo RX) przesuwa się po waypointach w jednym
+// przebiegu symulacji, a odbiory są zliczane w oknach po binPackets kolejnych pakietów TX.
+struct TrajectoryOptions
+{
+    bool moveJam = true;                              //!< rusza się jammer (scanTarget=jam), inaczej RX
+    std::vector<std::pair<double, Vector>> waypoints; //!< czas od startu ruchu (s) -> pozycja (m)
+    uint32_t binPackets = 100;                        //!< pakiety TX w jednym oknie
+};
+
+// Jedno okno trajektorii.
+struct TrajectoryBin
+{
+    double tStart = 0.0;       //!< czas (od startu ruchu) pierwszego pakietu TX okna
+    uint32_t sent = 0;         //!< wysłane pakiety TX
+    uint32_t rx = 0;           //!< pakiety TX odebrane przez RX
+    uint32_t jamRx = 0;        //!< pakiety jammerów odebrane przez RX
+    Vector sum{0.0, 0.0, 0.0}; //!< suma pozycji ruchomego węzła w chwilach wysyłek TX
+};
+
+// Scenariusz wielu BAN (--bans): pacjenci na kwadratowej siatce co `spacing` m, każdy z własnym
+// implantem TX i odbiornikiem RX na ciele, wszyscy na jednym kanale z jammerami.
+struct WardOptions
+{
+    uint32_t bans = 0;         //!< liczba łączy (0 = tryb wyłączony)
+    double spacing = 3.0;      //!< odległość między pacjentami (m)
+    double cutoffDbm = -120.0; //!< poniżej tej mocy sygnał nie jest dostarczany do odbiornika
+};
+
+// Jedno łącze TX -> RX pacjenta z własnymi licznikami.
+struct BanLink
+{
+    Ptr<Node> txNode;
+    Ptr<Node> rxNode;
+    Ptr<WbanNetDevice> txDev;
+    Ptr<WbanNetDevice> rxDev;
+    Ptr<ConstantPositionMobilityModel> mTx;
+    Ptr<ConstantPositionMobilityModel> mRx;
+    Ptr<Packet> txTemplate; //!< wzorzec pakietu tego TX (własny UID)
+    uint64_t txPacketUid = 0;
+    uint32_t noJamSent = 0;
+    uint32_t noJamRx = 0;
+    uint32_t jamSentTx = 0;
+    uint32_t jamRxTx = 0;
+    uint32_t jamRxJam = 0;  //!< odebrane pakiety jammerów
+    uint32_t otherBanRx = 0; //!< odebrane pakiety TX innych pacjentów
+};
+
+struct WardScenario;
+
+// Wejścia, od których zależy faza 1 (TX -> RX bez jammera): bity pozycji TX i RX, organ
+// i liczby warstw tłuszczu/mięśni.
+using NoJamPhaseKey = std::array<uint64_t, 7>;
+
+// Wynik fazy 1 zapamiętany dla kolejnych punktów o tym samym kluczu.
+struct NoJamPhaseResult
+{
+    uint32_t sent;
+    uint32_t rx;
+};
+
+// Sygnatura punktu dla --dedupScan: odległości TX-RX i JAM-RX zaokrąglone do 1 um, organ
+// i liczby warstw (oraz wzmocnienie jammera). Kanał zależy tylko od odległości (LogDistance + tłumienie ciała niezależne
+// od pozycji), a TX przez cały przebieg jest w PHY_TX_ON i nie odbiera, więc odległość TX-JAM
+// nie wpływa na wynik.
+using ScanSignature = std::array<int64_t, 6>;
+
+// Parametry przebiegu ustawiane z CLI; każdy kontekst ma własną kopię.
+struct ScenarioParameters
+{
+    uint32_t noJamPackets = 5000;   //!< ile pakietów bez jammingu
+    uint32_t withJamPackets = 5000; //!< ile pakietów z jammingiem
+    double txPowerDbm = -16.0;      //!< --txPowerDbm (np. -20, -16, -10, 0)
+    double rxSensitivityDbm = -98.0; //!< --rxSensitivityDbm (np. -113.97)
+    EarlyStopOptions earlyStop;
+    bool reuseNoJamPhase = true;    //!< --reuseNoJamPhase
+    std::vector<Vector> jammerPositions; //!< dodatkowe, nieruchome jammery (--jammerFile)
+    double jammerCullDbm = -120.0;       //!< --jammerCullDbm: poniżej tej mocy u RX jammer milczy
+    double shadowingSigmaDb = 0.0;       //!< --shadowingSigmaDb: zaciemnienie na LogDistance
+    double bodyShadowingSigmaDb = 0.0;   //!< --bodyShadowingSigmaDb: zaciemnienie tłumienia ciała
+    uint32_t replications = 1;           //!< --replications
+    uint64_t baseRun = 1;                //!< RngRun z CLI, z którego wyprowadzamy run każdego punktu
+
+    bool IsStochastic() const { return shadowingSigmaDb > 0.0 || bodyShadowingSigmaDb > 0.0; }
+};
+
+// Dodatkowy jammer z --jammerFile. Nadaje w fazie 2 razem z jammerem głównym, ale nie jest
+// odbiornikiem kanału, więc jego wysyłki nie są propagowane do pozostałych jammerów.
+struct ExtraJammer
+{
+    Ptr<Node> node;
+    Ptr<WbanNetDevice> dev;
+    Ptr<ConstantPositionMobilityModel> mobility;
+};
+
+// Kubełki siatki 3D z indeksami jammerów. Bok komórki to zasięg, poza którym moc jammera u RX
+// jest poniżej progu odcięcia, więc kandydaci dla danej pozycji RX leżą w 27 sąsiednich
+// komórkach; pozostałych jammerów nie sprawdzamy wcale. Bok 0 = jedna komórka ze wszystkimi.
+// WardSpectrumChannel trzyma w niej w ten sam sposób odbiorniki oddziału.
+class JammerGrid
+{
+public:
+    void Build(const std::vector<Vector>& positions, double cellSize)
+    {
+        m_cellSize = cellSize;
+        m_cells.clear();
+        for (uint32_t i = 0; i < positions.size(); ++i)
+        {
+            m_cells[CellOf(positions[i])].push_back(i);
+        }
+    }
+
+    void Query(const Vector& center, std::vector<uint32_t>& candidates) const
+    {
+        candidates.clear();
+        if (m_cellSize <= 0.0)
+        {
+            for (const auto& [cell, indices] : m_cells)
+            {
+                candidates.insert(candidates.end(), indices.begin(), indices.end());
+            }
+            return;
+        }
+        const Cell c = CellOf(center);
+        for (int64_t dx = -1; dx <= 1; ++dx)
+        {
+            for (int64_t dy = -1; dy <= 1; ++dy)
+            {
+                for (int64_t dz = -1; dz <= 1; ++dz)
+                {
+                    auto it = m_cells.find(Cell{c[0] + dx, c[1] + dy, c[2] + dz});
+                    if (it != m_cells.end())
+                    {
+                        candidates.insert(candidates.end(), it->second.begin(), it->second.end());
+                    }
+                }
+            }
+        }
+    }
+
+    size_t GetCellCount() const { return m_cells.size(); }
+
+private:
+    using Cell = std::array<int64_t, 3>;
+
+    Cell CellOf(const Vector& v) const
+    {
+        if (m_cellSize <= 0.0)
+        {
+            return Cell{0, 0, 0};
+        }
+        return Cell{static_cast<int64_t>(std::floor(v.x / m_cellSize)),
+                    static_cast<int64_t>(std::floor(v.y / m_cellSize)),
+                    static_cast<int64_t>(std::floor(v.z / m_cellSize))};
+    }
+
+    double m_cellSize = 0.0;
+    std::map<Cell, std::vector<uint32_t>> m_cells;
+};
+
+// Kanał scenariusza --bans. SingleModelSpectrumChannel przegląda przy każdej wysyłce wszystkie
+// odbiorniki (także przez filtr nadawania), więc koszt wysyłki rośnie z N. Tutaj odbiorniki leżą
+// w siatce JammerGrid o boku równym zasięgowi odcięcia, a nadajnik przy pierwszej wysyłce
+// dostaje listę odbiorników w zasięgu z 27 sąsiednich komórek. Węzły oddziału się nie ruszają,
+// więc lista jest ważna do końca przebiegu i wysyłka dotyka tylko sąsiadów. Straty liczy ten sam
+// łańcuch modeli co kanał kontekstu; modele widmowe i opóźnienie propagacji nie są używane
+// (kanał kontekstu też ich nie ma).
+class WardSpectrumChannel : public SpectrumChannel
+{
+public:
+    static TypeId GetTypeId()
+    {
+        static TypeId tid = TypeId("WardSpectrumChannel")
+            .SetParent<SpectrumChannel>()
+            .AddConstructor<WardSpectrumChannel>();
+        return tid;
+    }
+
+    void SetRange(double range)
+    {
+        m_range = range;
+        InvalidateNeighbours();
+    }
+
+    uint64_t GetDelivered() const { return m_delivered; }
+    uint64_t GetChecked() const { return m_checked; }
+    size_t GetNeighbourLists() const { return m_neighbours.size(); }
+
+    void AddRx(Ptr<SpectrumPhy> phy) override
+    {
+        if (std::find(m_rxPhys.begin(), m_rxPhys.end(), phy) == m_rxPhys.end())
+        {
+            m_rxPhys.push_back(phy);
+            InvalidateNeighbours();
+        }
+    }
+
+    void RemoveRx(Ptr<SpectrumPhy> phy) override
+    {
+        auto it = std::find(m_rxPhys.begin(), m_rxPhys.end(), phy);
+        if (it != m_rxPhys.end())
+        {
+            m_rxPhys.erase(it);
+            InvalidateNeighbours();
+        }
+    }
+
+    std::size_t GetNDevices() const override { return m_rxPhys.size(); }
+    Ptr<NetDevice> GetDevice(std::size_t i) const override { return m_rxPhys.at(i)->GetDevice(); }
+
+    // Jak SingleModelSpectrumChannel::StartTx(), ale tylko dla odbiorników z listy nadajnika;
+    // kolejność dostarczeń to kolejność rejestracji odbiorników, jak w kanale kontekstu.
+    void StartTx(Ptr<SpectrumSignalParameters> txParams) override
+    {
+        m_txSigsTrace(txParams);
+        Ptr<MobilityModel> txMobility = txParams->txPhy->GetMobility();
+        for (uint32_t index : GetNeighbours(txParams->txPhy, txMobility))
+        {
+            Ptr<SpectrumPhy> rxPhy = m_rxPhys[index];
+            Ptr<MobilityModel> rxMobility = rxPhy->GetMobility();
+            Ptr<SpectrumSignalParameters> rxParams = txParams->Copy();
+            if (txMobility && rxMobility && m_propagationLoss)
+            {
+                const double gainDb = m_propagationLoss->CalcRxPower(0.0, txMobility, rxMobility);
+                m_pathLossTrace(txParams->txPhy, rxPhy, -gainDb);
+                if (-gainDb > m_maxLossDb)
+                {
+                    continue;
+                }
+                rxParams->psd = Copy<SpectrumValue>(txParams->psd);
+                *(rxParams->psd) *= std::pow(10.0, gainDb / 10.0);
+            }
+            ++m_delivered;
+            Ptr<NetDevice> rxDevice = rxPhy->GetDevice();
+            if (rxDevice)
+            {
+                Simulator::ScheduleWithContext(rxDevice->GetNode()->GetId(),
+                                               Seconds(0),
+                                               &SpectrumPhy::StartRx,
+                                               rxPhy,
+                                               rxParams);
+            }
+            else
+            {
+                Simulator::Schedule(Seconds(0), &SpectrumPhy::StartRx, rxPhy, rxParams);
+            }
+        }
+    }
+
+private:
+    void InvalidateNeighbours()
+    {
+        m_neighbours.clear();
+        m_indexed = false;
+    }
+
+    const std::vector<uint32_t>& GetNeighbours(Ptr<SpectrumPhy> txPhy, Ptr<MobilityModel> txMobility)
+    {
+        auto found = m_neighbours.find(PeekPointer(txPhy));
+        if (found != m_neighbours.end())
+        {
+            return found->second;
+        }
+        if (!m_indexed)
+        {
+            std::vector<Vector> positions(m_rxPhys.size());
+            for (size_t i = 0; i < m_rxPhys.size(); ++i)
+            {
+                Ptr<MobilityModel> mobility = m_rxPhys[i]->GetMobility();
+                positions[i] = mobility ? mobility->GetPosition() : Vector();
+            }
+            m_grid.Build(positions, std::isfinite(m_range) ? m_range : 0.0);
+            m_indexed = true;
+        }
+
+        std::vector<uint32_t> candidates;
+        if (txMobility)
+        {
+            m_grid.Query(txMobility->GetPosition(), candidates);
+            std::sort(candidates.begin(), candidates.end());
+        }
+        else
+        {
+            candidates.resize(m_rxPhys.size());
+            std::iota(candidates.begin(), candidates.end(), 0u);
+        }
+        Ptr<NetDevice> txDevice = txPhy->GetDevice();
+        std::vector<uint32_t>& neighbours = m_neighbours[PeekPointer(txPhy)];
+        for (uint32_t index : candidates)
+        {
+            ++m_checked;
+            Ptr<SpectrumPhy> rxPhy = m_rxPhys[index];
+            Ptr<NetDevice> rxDevice = rxPhy->GetDevice();
+            Ptr<MobilityModel> rxMobility = rxPhy->GetMobility();
+            if (rxPhy == txPhy || (txDevice && rxDevice && txDevice->GetNode() == rxDevice->GetNode()))
+            {
+                continue;
+            }
+            if (txMobility && rxMobility &&
+                CalculateDistance(txMobility->GetPosition(), rxMobility->GetPosition()) > m_range)
+            {
+                continue;
+            }
+            neighbours.push_back(index);
+        }
+        return neighbours;
+    }
+
+    std::vector<Ptr<SpectrumPhy>> m_rxPhys;
+    double m_range = std::numeric_limits<double>::infinity();
+    JammerGrid m_grid; //!< odbiorniki w kubełkach o boku m_range
+    bool m_indexed = false;
+    std::unordered_map<const SpectrumPhy*, std::vector<uint32_t>> m_neighbours; //!< odbiorniki w zasięgu nadajnika
+    uint64_t m_delivered = 0;
+    uint64_t m_checked = 0;
+};
+
+struct WardScenario
+{
+    SimulationContext* ctx = nullptr;
+    WardOptions options;
+    std::vector<BanLink> links;
+    Ptr<WardSpectrumChannel> channel;
+    double range = 0.0;         //!< zasięg odcięcia (m)
+    bool jammingActive = false; //!< faza 2
+    uint64_t tagLookups = 0;    //!< odbiory, dla których źródło trzeba było odczytać z tagów
+    uint64_t events = 0;        //!< zdarzenia wykonane w RunWardScenario()
+    double runWallSec = 0.0;    //!< czas Simulator::Run() w RunWardScenario()
+};
+
+// Liczniki jednego punktu, zerowane na początku RunScenario() i zwiększane przez RxIndication().
+struct ScenarioCounters
+{
+    uint32_t noJamSent = 0;
+    uint32_t noJamRx = 0;
+    uint32_t jamSentTx = 0;
+    uint32_t jamRxTx = 0;
+    uint32_t jamSentJam = 0;
+    uint32_t jamRxJam = 0;
+    bool jammingActive = false;
+    uint32_t packetCopies = 0;
+    uint32_t tagLookups = 0;
+};
+
+// Statystyki całego skanu do raportów [Packets], [FastPath], [Resume], [NoJamCache] i [Dedup].
+struct SweepStats
+{
+    uint64_t packetCopies = 0;
+    uint64_t heapAllocations = 0;
+    uint64_t tagLookups = 0;
+    uint32_t fastPathAnalytic = 0;
+    uint32_t fastPathSimulated = 0;
+    uint32_t fastPathMatches = 0;
+    uint32_t fastPathMismatches = 0;
+    uint32_t journalRestored = 0;
+    uint64_t txSent = 0;
+    uint64_t txBudget = 0;
+    uint32_t noJamReused = 0;
+    uint32_t noJamSimulated = 0;
+    uint32_t dedupUnique = 0;
+    uint32_t dedupCopied = 0;
+    uint64_t jammersActive = 0;  //!< suma aktywnych jammerów z --jammerFile po punktach symulowanych
+    uint32_t jammerPoints = 0;   //!< punkty symulowane, po których liczona jest suma jammersActive
 };
 
+// Cały stan symulacji: węzły, kanał, parametry i liczniki. RxIndication jest związany z adresem
+// kontekstu, więc kontekst żyje pod stałym adresem (CreateSimulationContext zwraca unique_ptr)
+// i kilka kontekstów może istnieć w jednym procesie. Punkty różnych kontekstów liczymy po kolei,
+// bo Simulator jest wspólny.
 struct SimulationContext
 {
     Ptr<Node> txNode;
@@ -166,20 +796,153 @@ struct SimulationContext
     Ptr<WbanNetDevice> jamDev;
     Ptr<BodyPropagationLossModel> bodyLoss;
     Ptr<LogDistancePropagationLossModel> pathLoss;
+    Ptr<LinkShadowingPropagationLossModel> shadowing; //!< --shadowingSigmaDb (nullptr = bez zaciemnienia)
     Ptr<SingleModelSpectrumChannel> channel;
     Ptr<ConstantPositionMobilityModel> mTx;
     Ptr<ConstantPositionMobilityModel> mRx;
     Ptr<ConstantPositionMobilityModel> mJam;
+    std::vector<ExtraJammer> jammers;    //!< jammery z --jammerFile
+    JammerGrid jammerGrid;               //!< indeks przestrzenny jammers
+    double jamBoostDb = std::numeric_limits<double>::quiet_NaN(); //!< wzmocnienie w PSD jammerów (ApplyJamBoost)
+    std::vector<uint32_t> activeJammers; //!< jammers nadające w bieżącym punkcie (PrepareScenario)
+    Ptr<Packet> txTemplate;  //!< oznaczony SrcTag::TX wzorzec pakietu nadajnika
+    Ptr<Packet> jamTemplate; //!< oznaczony SrcTag::JAM wzorzec pakietu jammera
+    std::map<NoJamPhaseKey, NoJamPhaseResult> noJamCache; //!< wyniki fazy 1 (--reuseNoJamPhase)
+    std::map<ScanSignature, SimulationResult> dedupCache; //!< symulowane sygnatury (--dedupScan)
+    uint64_t txPacketUid = 0;  //!< UID txTemplate (i jego kopii)
+    uint64_t jamPacketUid = 0; //!< UID jamTemplate (i jego kopii)
+    ScenarioParameters parameters;
+    ScenarioCounters counters;
+    SweepStats stats;
+    ScanProfile* profile = nullptr; //!< --profile (nullptr = bez pomiarów)
+    CsvSink* csvSink = nullptr;     //!< CSV skanu; jego wątek zapisujący jest zatrzymywany na czas fork()
 };
 
-void ResetCounters();
-void RxIndication(uint32_t psduLength, Ptr<Packet> p, uint8_t packetSize);
-SimulationContext CreateSimulationContext(BodyOrganOption organ);
+class CsvRow;
+
+void CreatePacketTemplates(SimulationContext& ctx);
+bool LoadJammerPositions(const std::string& path, std::vector<Vector>& positions);
+void CreateExtraJammers(SimulationContext& ctx);
+double ShadowingMarginDb(const ScenarioParameters& parameters);
+double LinkRange(const SimulationContext& ctx, double txPowerDbm, double thresholdDbm);
+void ApplyJamBoost(SimulationContext& ctx, double jamBoostDb);
+void UpdateActiveJammers(SimulationContext& ctx);
+void RxIndication(SimulationContext* ctx, uint32_t psduLength, Ptr<Packet> p, uint8_t packetSize);
+std::unique_ptr<SimulationContext> CreateSimulationContext(BodyOrganOption organ,
+                                                           const ScenarioParameters& parameters);
+void SeedScenarioStreams(SimulationContext& ctx, const SimulationConfig& config);
+void PrepareScenario(SimulationContext& ctx, const SimulationConfig& config, SimulationResult& result);
+SimulationResult SummarizeReplications(const SimulationResult* replicas, uint32_t count);
+NoJamPhaseKey MakeNoJamPhaseKey(const SimulationContext& ctx, const SimulationConfig& config);
+ScanSignature MakeScanSignature(const SimulationContext& ctx, const SimulationConfig& config);
+SimulationResult CopySimulatedResult(SimulationContext& ctx,
+                                     const SimulationResult& source,
+                                     const SimulationConfig& config);
+void PlanDedup(SimulationContext& ctx,
+               const std::vector<SimulationConfig>& configs,
+               std::vector<size_t>& remaining,
+               std::vector<SimulationResult>& results,
+               std::vector<std::pair<size_t, size_t>>& copies,
+               std::map<ScanSignature, size_t>& representatives);
+void SeedNoJamCache(SimulationContext& ctx,
+                    const std::vector<SimulationConfig>& configs,
+                    uint32_t jobs,
+                    std::vector<size_t>& remaining,
+                    std::vector<SimulationResult>& results,
+                    std::vector<size_t>& seeded);
+void CalcPathRxPowers(SimulationContext& ctx,
+                      const std::vector<SimulationConfig>& configs,
+                      std::vector<double>& txRxPathDbm,
+                      std::vector<double>& jamPathDbm);
+bool PredictScenario(SimulationContext& ctx,
+                     const SimulationConfig& config,
+                     double txRxPathDbm,
+                     double jamPathDbm,
+                     double marginDb,
+                     SimulationResult& result);
 SimulationResult RunScenario(SimulationContext& ctx, const SimulationConfig& config, bool enableLogs);
+std::vector<double> BuildScanPositions(double scanStart, double scanStop, double scanStep);
+SimulationConfig MakeScanConfig(const SimulationConfig& baseConfig, bool scanJam, double scanPos);
+bool RunScenarioBatch(SimulationContext& ctx,
+                      const std::vector<SimulationConfig>& configs,
+                      const SweepOptions& options,
+                      std::vector<SimulationResult>& results);
+bool RunPendingScenarios(SimulationContext& ctx,
+                         const std::vector<SimulationConfig>& configs,
+                         const std::vector<size_t>& pending,
+                         uint32_t jobs,
+                         std::vector<SimulationResult>& results);
+void ReportFastPath(const SimulationContext& ctx, const SweepOptions& options);
+void ReportPacketStats(const SimulationContext& ctx);
+void ReportJournal(const SimulationContext& ctx);
+void ReportJammers(const SimulationContext& ctx);
+uint64_t HashBytes(const void* data, size_t size, uint64_t seed);
+uint64_t ScenarioFingerprint(const SimulationContext& ctx);
+uint64_t JournalFingerprint(const SimulationContext& ctx, const SweepOptions& options);
+bool IsJammed(const SimulationResult& res, double jamThreshold);
+double NormalQuantile(double p);
+double EarlyStopZ(const EarlyStopOptions& earlyStop, uint32_t packets);
+void WilsonInterval(uint32_t successes, uint32_t trials, double z, double& low, double& high);
+bool IsRateDecided(const EarlyStopOptions& earlyStop, uint32_t successes, uint32_t trials, double z);
+bool IsRatePrecise(const EarlyStopOptions& earlyStop, uint32_t successes, uint32_t trials, double z);
+double ScanDistance(const SimulationResult& res, bool scanJam);
+std::string ScanCsvHeader(const SimulationContext& ctx, const SweepOptions& options);
+std::string GridCsvHeader(const SimulationContext& ctx, const SweepOptions& options);
+void AppendEarlyStopColumns(const SimulationContext& ctx, CsvRow& row, const SimulationResult& res);
+void WriteScanCsvRow(const SimulationContext& ctx,
+                     CsvSink& csv,
+                     const SimulationResult& res,
+                     double scanCoordinate,
+                     double jamThreshold,
+                     const SweepOptions& options);
+bool FindFirstSafeIndex(SimulationContext& ctx,
+                        const std::vector<SimulationConfig>& configs,
+                        const SweepOptions& options,
+                        double jamThreshold,
+                        std::map<size_t, SimulationResult>& evaluated,
+                        size_t& firstSafe);
+std::string PowerCsvHeader(const SweepOptions& options);
+bool RunPowerSolver(SimulationContext& ctx,
+                    const std::vector<SimulationConfig>& configs,
+                    const std::vector<double>& scanPositions,
+                    bool scanJam,
+                    const PowerSolverOptions& solver,
+                    const SweepOptions& options,
+                    double jamThreshold,
+                    CsvSink& csv);
+bool RunGridScan(SimulationContext& ctx,
+                 const SimulationConfig& baseConfig,
+                 const GridScanOptions& grid,
+                 const SweepOptions& options,
+                 double jamThreshold,
+                 CsvSink& csv);
+bool LoadTrajectory(const std::string& path, std::vector<std::pair<double, Vector>>& waypoints);
+void BuildLinearTrajectory(const SimulationConfig& baseConfig,
+                           double scanStart,
+                           double scanStop,
+                           double scanStep,
+                           TrajectoryOptions& trajectory);
+std::vector<TrajectoryBin> RunTrajectory(SimulationContext& ctx,
+                                         const SimulationConfig& config,
+                                         const TrajectoryOptions& trajectory,
+                                         bool withJammer);
+std::string TrajectoryCsvHeader(const SweepOptions& options);
+void RunTrajectoryScan(SimulationContext& ctx,
+                       const SimulationConfig& baseConfig,
+                       const TrajectoryOptions& trajectory,
+                       const SweepOptions& options,
+                       double jamThreshold,
+                       CsvSink& csv,
+                       double& firstSafeDistance);
+void WardRxIndication(WardScenario* ward, uint32_t link, uint32_t psduLength, Ptr<Packet> p, uint8_t packetSize);
+std::unique_ptr<WardScenario> CreateWardScenario(SimulationContext& ctx,
+                                                 const SimulationConfig& baseConfig,
+                                                 const WardOptions& options);
+void RunWardScenario(WardScenario& ward, bool report);
+void WriteWardCsv(const WardScenario& ward, const SimulationConfig& baseConfig, double jamThreshold, CsvSink* csv);
+bool WriteProfile(const SimulationContext& ctx, const std::string& profile);
 
 // ===== Parametry eksperymentu =====z
-static uint32_t kNoJamPackets   = 5000;   // ile pakietów bez jammingu (można zmienić z CLI)
-static uint32_t kWithJamPackets = 5000;   // ile pakietów z jammingiem (można zmienić z CLI)
 static const double kPktGapSeconds    = 0.02; //kPktGapSeconds dla różnych obciążeń (np. 0.1s, 0.02s, 0.005s).
 static const double kGapBetweenPhases = 1.0;
 static const uint32_t kPrintEvery     = 500;
@@ -187,32 +950,19 @@ static const uint32_t kPrintEvery     = 500;
 // WBAN / PHY
 static const uint32_t kChannelNumber = 1;
 static const int      kPayloadBytes  = 32;
-static const double   kTxPowerDbm    = -16.0; //dobrze -20, -16, -10, 0
-static const double   kJamBoostDb    = 0.0; // +6, +10, +20
-static const double   kRxSensitivity = -98; // -113.97
-
-// ===== Liczniki =====
-static uint32_t g_noJamSent = 0, g_noJamRx = 0;
-static uint32_t g_jamSentTx = 0, g_jamRxTx = 0;
-static uint32_t g_jamSentJam = 0, g_jamRxJam = 0;
-static bool     g_jammingActive = false;
+// zapas zasięgów odcięcia przy zaciemnieniu, w odchyleniach standardowych
+static const double   kShadowingRangeSigmas = 3.0;
+// moc TX i czułość RX są w ScenarioParameters, wzmocnienie jammera w SimulationConfig
 
-void
-ResetCounters()
-{
-    g_noJamSent = 0;
-    g_noJamRx = 0;
-    g_jamSentTx = 0;
-    g_jamRxTx = 0;
-    g_jamSentJam = 0;
-    g_jamRxJam = 0;
-    g_jammingActive = false;
-}
+// Kolejka zdarzeń należy do singletonu Simulator, nie do kontekstu (liczy ProfilingScheduler).
+static uint64_t g_eventQueueDepth = 0, g_eventQueuePeak = 0;
 
-SimulationContext
-CreateSimulationContext(BodyOrganOption organ)
+std::unique_ptr<SimulationContext>
+CreateSimulationContext(BodyOrganOption organ, const ScenarioParameters& parameters)
 {
-    SimulationContext ctx;
+    auto context = std::make_unique<SimulationContext>();
+    SimulationContext& ctx = *context;
+    ctx.parameters = parameters;
     ctx.txNode = CreateObject<Node>();
     ctx.rxNode = CreateObject<Node>();
     ctx.jamNode = CreateObject<Node>();
@@ -225,8 +975,15 @@ CreateSimulationContext(BodyOrganOption organ)
     ctx.bodyLoss = CreateObject<BodyPropagationLossModel>();
     ctx.pathLoss = CreateObject<LogDistancePropagationLossModel>();
     ctx.bodyLoss->SetBodyOptions(organ);
+    ctx.bodyLoss->SetAttribute("ShadowingSigmaDb", DoubleValue(parameters.bodyShadowingSigmaDb));
     ctx.channel->AddPropagationLossModel(ctx.bodyLoss);
     ctx.channel->AddPropagationLossModel(ctx.pathLoss);
+    if (parameters.shadowingSigmaDb > 0.0)
+    {
+        ctx.shadowing = CreateObject<LinkShadowingPropagationLossModel>();
+        ctx.shadowing->SetAttribute("SigmaDb", DoubleValue(parameters.shadowingSigmaDb));
+        ctx.channel->AddPropagationLossModel(ctx.shadowing);
+    }
 
     ctx.txDev->SetChannel(ctx.channel);
     ctx.rxDev->SetChannel(ctx.channel);
@@ -247,197 +1004,3190 @@ CreateSimulationContext(BodyOrganOption organ)
     ctx.bodyLoss->AddBodyMobility(ctx.mTx);
 
     WbanSpectrumValueHelper svh;
-    Ptr<SpectrumValue> psdTx = svh.CreateTxPowerSpectralDensity(kTxPowerDbm, kChannelNumber);
-    Ptr<SpectrumValue> psdJam = svh.CreateTxPowerSpectralDensity(kTxPowerDbm + kJamBoostDb, kChannelNumber);
+    Ptr<SpectrumValue> psdTx = svh.CreateTxPowerSpectralDensity(parameters.txPowerDbm, kChannelNumber);
     ctx.txDev->GetPhy()->SetTxPowerSpectralDensity(psdTx);
-    ctx.jamDev->GetPhy()->SetTxPowerSpectralDensity(psdJam);
+    // PSD jammerów ustawia ApplyJamBoost przy przygotowaniu punktu
 
-    ctx.rxDev->GetPhy()->SetRxSensitivity(kRxSensitivity);
-    ctx.rxDev->GetPhy()->SetPhyDataIndicationCallback(MakeCallback(&RxIndication));
+    ctx.rxDev->GetPhy()->SetRxSensitivity(parameters.rxSensitivityDbm);
+    ctx.rxDev->GetPhy()->SetPhyDataIndicationCallback(MakeBoundCallback(&RxIndication, &ctx));
 
-    return ctx;
+    CreatePacketTemplates(ctx);
+    CreateExtraJammers(ctx);
+
+    return context;
 }
 
-// ===== Tag źródła =====
-class SrcTag : public Tag
+// Plik --jammerFile: jeden jammer na linię, "x y [z]" w metrach; '#' zaczyna komentarz.
+bool
+LoadJammerPositions(const std::string& path, std::vector<Vector>& positions)
 {
-public:
-    enum SrcType { TX = 1, JAM = 2 };
-    SrcTag(SrcType t = TX) : m_type(t) {}
-
-    static TypeId GetTypeId (void) {
-        static TypeId tid = TypeId("SrcTag")
-            .SetParent<Tag>()
-            .AddConstructor<SrcTag>();
-        return tid;
+    std::ifstream in(path);
+    if (!in)
+    {
+        std::cerr << "[Jammers] Nie można otworzyć pliku '" << path << "'" << std::endl;
+        return false;
     }
-    TypeId GetInstanceTypeId (void) const override { return GetTypeId(); }
-    uint32_t GetSerializedSize (void) const override { return 1; }
-    void Serialize (TagBuffer i) const override { i.WriteU8((uint8_t)m_type); }
-    void Deserialize (TagBuffer i) override { m_type = (SrcType) i.ReadU8(); }
-    void Print (std::ostream &os) const override { os << "src=" << (m_type==TX?"TX":"JAM"); }
-
-    void Set(SrcType t) { m_type = t; }
-    SrcType Get() const { return m_type; }
-
-private:
-    SrcType m_type;
-};
-
-void RxIndication(uint32_t psduLength, Ptr<Packet> p, uint8_t packetSize)
-{
-    SrcTag tag;
-    if (p->PeekPacketTag(tag)) {
-        if (g_jammingActive) {
-            if (tag.Get() == SrcTag::TX) g_jamRxTx++;
-            else g_jamRxJam++;
-        } else {
-            g_noJamRx++;
+    positions.clear();
+    std::string line;
+    for (uint32_t lineNumber = 1; std::getline(in, line); ++lineNumber)
+    {
+        line = line.substr(0, line.find('#'));
+        std::istringstream fields(line);
+        std::vector<double> values;
+        double value;
+        while (fields >> value)
+        {
+            values.push_back(value);
+        }
+        if (values.empty() && fields.eof())
+        {
+            continue;
+        }
+        if (!fields.eof() || values.size() < 2 || values.size() > 3)
+        {
+            std::cerr << "[Jammers] " << path << ":" << lineNumber << ": oczekiwano \"x y [z]\"" << std::endl;
+            return false;
         }
+        positions.emplace_back(values[0], values[1], values.size() == 3 ? values[2] : 0.0);
     }
+    return true;
 }
-// t   r       j
 
+void
+CreateExtraJammers(SimulationContext& ctx)
+{
+    const std::vector<Vector>& positions = ctx.parameters.jammerPositions;
+    if (positions.empty())
+    {
+        return;
+    }
+    ctx.jammers.reserve(positions.size());
+    for (const Vector& position : positions)
+    {
+        ExtraJammer jammer;
+        jammer.node = CreateObject<Node>();
+        jammer.dev = CreateObject<WbanNetDevice>();
+        jammer.dev->SetChannel(ctx.channel);
+        // jammer tylko nadaje: bez tego każda wysyłka byłaby propagowana do wszystkich jammerów
+        ctx.channel->RemoveRx(jammer.dev->GetPhy());
+        jammer.node->AddDevice(jammer.dev);
+        jammer.mobility = CreateObject<ConstantPositionMobilityModel>();
+        jammer.mobility->SetPosition(position);
+        jammer.dev->GetPhy()->SetMobility(jammer.mobility);
+        ctx.jammers.push_back(jammer);
+    }
+    std::cout << "[Jammers] " << positions.size() << " jammerów z pliku" << std::endl;
+}
+
+// Ustawia moc nadawania jammera głównego i jammerów z --jammerFile na txPowerDbm + jamBoostDb.
+// Zasięg odcięcia rośnie z mocą, więc siatka jammerów jest budowana od nowa dla nowego
+// wzmocnienia; punkty z tym samym wzmocnieniem nic nie przeliczają.
+void
+ApplyJamBoost(SimulationContext& ctx, double jamBoostDb)
+{
+    if (ctx.jamBoostDb == jamBoostDb)
+    {
+        return;
+    }
+    ctx.jamBoostDb = jamBoostDb;
+    const double jamPowerDbm = ctx.parameters.txPowerDbm + jamBoostDb;
+    WbanSpectrumValueHelper svh;
+    Ptr<SpectrumValue> psdJam = svh.CreateTxPowerSpectralDensity(jamPowerDbm, kChannelNumber);
+    ctx.jamDev->GetPhy()->SetTxPowerSpectralDensity(psdJam);
+    if (ctx.jammers.empty())
+    {
+        return;
+    }
+    for (ExtraJammer& jammer : ctx.jammers)
+    {
+        jammer.dev->GetPhy()->SetTxPowerSpectralDensity(psdJam);
+    }
+    const double range = LinkRange(ctx, jamPowerDbm, ctx.parameters.jammerCullDbm);
+    ctx.jammerGrid.Build(ctx.parameters.jammerPositions, std::isfinite(range) ? range : 0.0);
+}
+
+// Zapas mocy na zaciemnienie: kShadowingRangeSigmas odchyleń obu składowych (suma odchyleń
+// zamiast pierwiastka z sumy kwadratów, więc z nadmiarem). Bez zaciemnienia 0.
+double
+ShadowingMarginDb(const ScenarioParameters& parameters)
+{
+    return kShadowingRangeSigmas * (parameters.shadowingSigmaDb + parameters.bodyShadowingSigmaDb);
+}
+
+// Odległość, powyżej której nadajnik o mocy txPowerDbm nie przekracza thresholdDbm u odbiornika.
+// Liczona z samego LogDistance (tłumienie ciała tylko obniża moc) powiększonego o zapas
+// ShadowingMarginDb, więc jest górnym ograniczeniem zasięgu także przy zaciemnieniu (poza
+// losowaniami dalszymi niż kShadowingRangeSigmas odchyleń).
+double
+LinkRange(const SimulationContext& ctx, double txPowerDbm, double thresholdDbm)
+{
+    DoubleValue exponent;
+    DoubleValue referenceDistance;
+    DoubleValue referenceLoss;
+    ctx.pathLoss->GetAttribute("Exponent", exponent);
+    ctx.pathLoss->GetAttribute("ReferenceDistance", referenceDistance);
+    ctx.pathLoss->GetAttribute("ReferenceLoss", referenceLoss);
+    const double marginDb =
+        txPowerDbm + ShadowingMarginDb(ctx.parameters) - referenceLoss.Get() - thresholdDbm;
+    if (marginDb <= 0.0)
+    {
+        return referenceDistance.Get();
+    }
+    if (exponent.Get() <= 0.0)
+    {
+        return std::numeric_limits<double>::infinity();
+    }
+    return referenceDistance.Get() * std::pow(10.0, marginDb / (10.0 * exponent.Get()));
+}
+
+// Wybiera jammery z --jammerFile, które nadają w bieżącym punkcie: kandydaci z siatki wokół RX,
+// a z nich te, których moc u RX (ten sam łańcuch strat co w kanale, bez zaciemnienia) powiększona
+// o zapas ShadowingMarginDb jest >= jammerCullDbm.
+void
+UpdateActiveJammers(SimulationContext& ctx)
+{
+    ctx.activeJammers.clear();
+    if (ctx.jammers.empty())
+    {
+        return;
+    }
+    std::vector<uint32_t> candidates;
+    ctx.jammerGrid.Query(ctx.mRx->GetPosition(), candidates);
+    for (uint32_t index : candidates)
+    {
+        const double rxDbm =
+            ctx.pathLoss->CalcRxPower(ctx.parameters.txPowerDbm + ctx.jamBoostDb, ctx.jammers[index].mobility, ctx.mRx);
+        if (rxDbm + ShadowingMarginDb(ctx.parameters) >= ctx.parameters.jammerCullDbm)
+        {
+            ctx.activeJammers.push_back(index);
+        }
+    }
+    // kolejność wysyłek w jednej chwili nie zależy od kolejności komórek siatki
+    std::sort(ctx.activeJammers.begin(), ctx.activeJammers.end());
+}
+
+// ===== Tag źródła =====
+class SrcTag : public Tag
+{
+public:
+    enum SrcType { TX = 1, JAM = 2 };
+    SrcTag(SrcType t = TX) : m_type(t) {}
+
+    static TypeId GetTypeId (void) {
+        static TypeId tid = TypeId("SrcTag")
+            .SetParent<Tag>()
+            .AddConstructor<SrcTag>();
+        return tid;
+    }
+    TypeId GetInstanceTypeId (void) const override { return GetTypeId(); }
+    uint32_t GetSerializedSize (void) const override { return 1; }
+    void Serialize (TagBuffer i) const override { i.WriteU8((uint8_t)m_type); }
+    void Deserialize (TagBuffer i) override { m_type = (SrcType) i.ReadU8(); }
+    void Print (std::ostream &os) const override { os << "src=" << (m_type==TX?"TX":"JAM"); }
+
+    void Set(SrcType t) { m_type = t; }
+    SrcType Get() const { return m_type; }
+
+private:
+    SrcType m_type;
+};
+
+// Numer łącza w scenariuszu --bans; pozwala przypisać pakiet TX do pacjenta, gdy PHY podmieni
+// pakiet i UID wzorca nie pasuje.
+class BanTag : public Tag
+{
+public:
+    BanTag(uint32_t link = 0) : m_link(link) {}
+
+    static TypeId GetTypeId (void) {
+        static TypeId tid = TypeId("BanTag")
+            .SetParent<Tag>()
+            .AddConstructor<BanTag>();
+        return tid;
+    }
+    TypeId GetInstanceTypeId (void) const override { return GetTypeId(); }
+    uint32_t GetSerializedSize (void) const override { return 4; }
+    void Serialize (TagBuffer i) const override { i.WriteU32(m_link); }
+    void Deserialize (TagBuffer i) override { m_link = i.ReadU32(); }
+    void Print (std::ostream &os) const override { os << "ban=" << m_link; }
+
+    uint32_t Get() const { return m_link; }
+
+private:
+    uint32_t m_link;
+};
+
+// ===== Źródło ruchu =====
+// Samo-odnawiające się źródło pakietów: zamiast wstawiać do kolejki zdarzeń wszystkie wysyłki
+// fazy naraz, trzyma tylko jedno oczekujące zdarzenie (następną wysyłkę) i planuje kolejne
+// dopiero po wykonaniu poprzedniego. Kolejka ma więc rozmiar O(1) względem liczby pakietów,
+// a kolejność zdarzeń o tym samym czasie jest taka sama jak przy planowaniu z góry.
+class TrafficSource
+{
+public:
+    using SendCallback = std::function<void(uint32_t index)>;
+
+    ~TrafficSource() { Stop(); }
+
+    void Start(Time delay, Time gap, uint32_t count, SendCallback send)
+    {
+        Stop();
+        m_gap = gap;
+        m_count = count;
+        m_sent = 0;
+        m_send = std::move(send);
+        if (m_count > 0)
+        {
+            m_event = Simulator::Schedule(delay, &TrafficSource::Send, this);
+        }
+    }
+
+    void Stop() { m_event.Cancel(); }
+
+    uint32_t GetSent() const { return m_sent; }
+
+private:
+    void Send()
+    {
+        uint32_t index = m_sent++;
+        if (m_sent < m_count)
+        {
+            m_event = Simulator::Schedule(m_gap, &TrafficSource::Send, this);
+        }
+        m_send(index);
+    }
+
+    Time m_gap;
+    uint32_t m_count = 0;
+    uint32_t m_sent = 0;
+    SendCallback m_send;
+    EventId m_event;
+};
+
+// Chwila pomiaru: zegar monotoniczny i czas CPU bieżącego wątku.
+struct ProfileSample
+{
+    double wallSec = 0.0;
+    double cpuSec = 0.0;
+
+    static ProfileSample Now()
+    {
+        timespec wall;
+        timespec cpu;
+        clock_gettime(CLOCK_MONOTONIC, &wall);
+        clock_gettime(CLOCK_THREAD_CPUTIME_ID, &cpu);
+        return ProfileSample{wall.tv_sec + wall.tv_nsec * 1e-9, cpu.tv_sec + cpu.tv_nsec * 1e-9};
+    }
+};
+
+// Wiersz CSV przechowywany jako surowe wartości; separatory dokłada formatowanie.
+class CsvRow
+{
+public:
+    static constexpr size_t kMaxFields = 32;
+
+    CsvRow& operator<<(double value) { return Add(Field{Field::NUMBER, value, 0, nullptr}); }
+    CsvRow& operator<<(int value) { return Add(Field{Field::INTEGER, 0.0, value, nullptr}); }
+    CsvRow& operator<<(uint32_t value) { return Add(Field{Field::INTEGER, 0.0, value, nullptr}); }
+    // tylko literały lub inne napisy żyjące do zamknięcia CsvSink
+    CsvRow& operator<<(const char* value) { return Add(Field{Field::TEXT, 0.0, 0, value}); }
+
+    // Formatuje jak domyślny std::ostream: double jako "%g" z precyzją 6, bez zależności od locale.
+    void AppendTo(std::string& out) const
+    {
+        char buf[32];
+        for (size_t i = 0; i < m_size; ++i)
+        {
+            if (i > 0)
+            {
+                out.push_back(',');
+            }
+            const Field& field = m_fields[i];
+            std::to_chars_result res{buf, std::errc{}};
+            switch (field.kind)
+            {
+            case Field::NUMBER:
+                res = std::to_chars(buf, buf + sizeof(buf), field.number, std::chars_format::general, 6);
+                break;
+            case Field::INTEGER:
+                res = std::to_chars(buf, buf + sizeof(buf), field.integer);
+                break;
+            case Field::TEXT:
+                out.append(field.text);
+                continue;
+            }
+            out.append(buf, res.ptr);
+        }
+        out.push_back('\n');
+    }
+
+private:
+    struct Field
+    {
+        enum Kind : uint8_t
+        {
+            NUMBER,
+            INTEGER,
+            TEXT
+        } kind;
+        double number;
+        int64_t integer;
+        const char* text;
+    };
+
+    CsvRow& Add(const Field& field)
+    {
+        NS_ABORT_MSG_IF(m_size >= kMaxFields, "CsvRow: za dużo kolumn (max " << kMaxFields << ")");
+        m_fields[m_size++] = field;
+        return *this;
+    }
+
+    std::array<Field, kMaxFields> m_fields;
+    size_t m_size = 0;
+};
+
+// Zapis wyników do CSV w osobnym wątku. Wątek symulacji tylko kopiuje wartości do CsvRow;
+// paczki po kBatchRows wierszy trafiają do kolejki ograniczonej do kMaxQueuedBatches
+// (przy pełnej kolejce Push czeka), a wątek zapisujący formatuje je std::to_chars do bufora
+// i zapisuje do pliku porcjami po kChunkBytes.
+// Przed fork() workerów skanu wątek zapisujący jest zatrzymywany (Pause), żeby proces potomny
+// nie odziedziczył muteksu ani strumienia w trakcie zapisu; workery kończą się _exit.
+class CsvSink
+{
+public:
+    static constexpr size_t kBatchRows = 1024;
+    static constexpr size_t kMaxQueuedBatches = 64;
+    static constexpr size_t kChunkBytes = 1 << 20;
+
+    ~CsvSink() { Close(); }
+
+    bool Open(const fs::path& path, const std::string& header)
+    {
+        m_file.open(path, std::ios::out | std::ios::trunc | std::ios::binary);
+        if (!m_file.is_open())
+        {
+            return false;
+        }
+        m_buffer.reserve(kChunkBytes + 4096);
+        m_buffer = header;
+        m_buffer.push_back('\n');
+        m_batch.reserve(kBatchRows);
+        m_closing = false;
+        m_writer = std::thread(&CsvSink::Run, this);
+        return true;
+    }
+
+    // Zapisuje zaległe wiersze i kończy wątek zapisujący (plik pozostaje otwarty).
+    void Pause()
+    {
+        if (!m_writer.joinable())
+        {
+            return;
+        }
+        StopWriter();
+        m_paused = true;
+    }
+
+    // Ponownie uruchamia wątek zatrzymany przez Pause().
+    void Resume()
+    {
+        if (!m_paused)
+        {
+            return;
+        }
+        m_paused = false;
+        m_closing = false;
+        m_writer = std::thread(&CsvSink::Run, this);
+    }
+
+    void Push(const CsvRow& row)
+    {
+        m_batch.push_back(row);
+        if (m_batch.size() >= kBatchRows)
+        {
+            Enqueue();
+        }
+    }
+
+    // Dopisuje zaległe wiersze, czeka na wątek zapisujący i zamyka plik.
+    // Zwraca false, jeśli któryś zapis się nie powiódł.
+    bool Close()
+    {
+        if (!m_writer.joinable() && !m_paused)
+        {
+            return m_ok;
+        }
+        if (m_writer.joinable())
+        {
+            StopWriter();
+        }
+        m_paused = false;
+        m_file.close();
+        m_ok = m_ok && !m_file.fail();
+        return m_ok;
+    }
+
+    // Statystyki wątku zapisującego; poprawne po Close().
+    uint64_t GetBytesWritten() const { return m_bytesWritten; }
+    double GetWriteWallSeconds() const { return m_writeWallSec; }
+    double GetWriteCpuSeconds() const { return m_writeCpuSec; }
+
+private:
+    void StopWriter()
+    {
+        Enqueue();
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_closing = true;
+        }
+        m_notEmpty.notify_one();
+        m_writer.join();
+    }
+
+    void Enqueue()
+    {
+        if (m_batch.empty())
+        {
+            return;
+        }
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_notFull.wait(lock, [this] { return m_queue.size() < kMaxQueuedBatches; });
+        m_queue.push_back(std::move(m_batch));
+        lock.unlock();
+        m_notEmpty.notify_one();
+        m_batch = std::vector<CsvRow>();
+        m_batch.reserve(kBatchRows);
+    }
+
+    void Run()
+    {
+        while (true)
+        {
+            std::vector<CsvRow> batch;
+            {
+                std::unique_lock<std::mutex> lock(m_mutex);
+                m_notEmpty.wait(lock, [this] { return !m_queue.empty() || m_closing; });
+                if (m_queue.empty())
+                {
+                    break;
+                }
+                batch = std::move(m_queue.front());
+                m_queue.pop_front();
+            }
+            m_notFull.notify_one();
+
+            // czas formatowania i zapisu, bez czekania na kolejne porcje
+            ProfileSample begin = ProfileSample::Now();
+            for (const CsvRow& row : batch)
+            {
+                row.AppendTo(m_buffer);
+            }
+            if (m_buffer.size() >= kChunkBytes)
+            {
+                WriteBuffer();
+            }
+            AddWriteTime(begin);
+        }
+        ProfileSample begin = ProfileSample::Now();
+        WriteBuffer();
+        AddWriteTime(begin);
+    }
+
+    void WriteBuffer()
+    {
+        m_file.write(m_buffer.data(), static_cast<std::streamsize>(m_buffer.size()));
+        m_ok = m_ok && m_file.good();
+        m_bytesWritten += m_buffer.size();
+        m_buffer.clear();
+    }
+
+    void AddWriteTime(const ProfileSample& begin)
+    {
+        ProfileSample end = ProfileSample::Now();
+        m_writeWallSec += end.wallSec - begin.wallSec;
+        m_writeCpuSec += end.cpuSec - begin.cpuSec;
+    }
+
+    std::ofstream m_file;
+    std::string m_buffer;                  //!< tylko wątek zapisujący (po Open)
+    std::vector<CsvRow> m_batch;           //!< tylko wątek symulacji
+    std::deque<std::vector<CsvRow>> m_queue;
+    std::mutex m_mutex;
+    std::condition_variable m_notEmpty;
+    std::condition_variable m_notFull;
+    bool m_closing = false;
+    bool m_paused = false;                 //!< wątek zatrzymany przez Pause(), plik otwarty
+    bool m_ok = true;
+    uint64_t m_bytesWritten = 0;           //!< pola statystyk: tylko wątek zapisujący (po Open)
+    double m_writeWallSec = 0.0;
+    double m_writeCpuSec = 0.0;
+    std::thread m_writer;
+};
+
+// Dziennik policzonych punktów skanu: nagłówek z odciskiem ustawień, potem rekordy
+// (klucz konfiguracji, SimulationResult, suma kontrolna) dopisywane po każdej porcji punktów
+// i utrwalane fsync. Kluczem jest konfiguracja, a nie indeks, więc dziennik działa dla skanu
+// liniowego, bisekcji i siatki. Przy wznowieniu urwany ostatni rekord jest odcinany.
+class ScanJournal
+{
+public:
+    ~ScanJournal() { Close(); }
+
+    bool Open(const fs::path& path, uint64_t fingerprint, bool resume)
+    {
+        m_path = path;
+        long goodSize = 0;
+        if (resume)
+        {
+            if (!Load(fingerprint, goodSize))
+            {
+                return false;
+            }
+        }
+
+        m_file = std::fopen(m_path.c_str(), goodSize > 0 ? "r+b" : "wb");
+        if (!m_file)
+        {
+            std::cerr << "[Resume] Nie można otworzyć dziennika '" << m_path.string() << "'" << std::endl;
+            return false;
+        }
+        if (goodSize > 0)
+        {
+            if (ftruncate(fileno(m_file), goodSize) != 0 || std::fseek(m_file, goodSize, SEEK_SET) != 0)
+            {
+                std::cerr << "[Resume] Nie można przyciąć dziennika '" << m_path.string() << "'" << std::endl;
+                return false;
+            }
+            return true;
+        }
+        Header header{{}, kVersion, fingerprint};
+        std::copy(std::begin(kMagic), std::end(kMagic), header.magic);
+        return std::fwrite(&header, sizeof(header), 1, m_file) == 1 && Sync();
+    }
+
+    size_t GetSize() const { return m_done.size(); }
+
+    bool Lookup(const SimulationConfig& config, SimulationResult& result) const
+    {
+        auto it = m_done.find(MakeKey(config));
+        if (it == m_done.end())
+        {
+            return false;
+        }
+        result = it->second;
+        return true;
+    }
+
+    bool Append(const std::vector<SimulationConfig>& configs,
+                const std::vector<size_t>& indices,
+                const std::vector<SimulationResult>& results)
+    {
+        for (size_t index : indices)
+        {
+            Record record = Record();
+            record.key = MakeKey(configs[index]);
+            record.result = results[index];
+            record.checksum = RecordChecksum(record);
+            if (std::fwrite(&record, sizeof(record), 1, m_file) != 1)
+            {
+                return false;
+            }
+            m_done[record.key] = record.result;
+        }
+        return Sync();
+    }
+
+    // Zamyka i usuwa dziennik po poprawnie zakończonym skanie.
+    void Remove()
+    {
+        Close();
+        std::error_code ec;
+        fs::remove(m_path, ec);
+    }
+
+private:
+    using Key = std::array<uint64_t, 9>;
+
+    static constexpr char kMagic[8] = {'W', 'B', 'A', 'N', 'J', 'R', 'N', 'L'};
+    static constexpr uint32_t kVersion = 3;
+
+    struct Header
+    {
+        char magic[8];
+        uint32_t version;
+        uint64_t fingerprint;
+    };
+
+    struct Record
+    {
+        Key key;
+        SimulationResult result;
+        uint64_t checksum;
+    };
+
+    static Key MakeKey(const SimulationConfig& config)
+    {
+        Key key{};
+        const double values[] = {config.txX, config.txY, config.rxX, config.rxY,
+                                 config.jamX, config.jamY, config.jamZ};
+        std::memcpy(key.data(), values, sizeof(values));
+        key[7] = static_cast<uint64_t>(config.organOption) | static_cast<uint64_t>(config.replication) << 32;
+        std::memcpy(&key[8], &config.jamBoostDb, sizeof(config.jamBoostDb));
+        return key;
+    }
+
+    static uint64_t RecordChecksum(const Record& record)
+    {
+        return HashBytes(&record, offsetof(Record, checksum), sizeof(Record));
+    }
+
+    bool Load(uint64_t fingerprint, long& goodSize)
+    {
+        std::FILE* in = std::fopen(m_path.c_str(), "rb");
+        if (!in)
+        {
+            std::cout << "[Resume] Brak dziennika '" << m_path.string() << "', skan zaczyna się od początku"
+                      << std::endl;
+            return true;
+        }
+        Header header;
+        bool headerOk = std::fread(&header, sizeof(header), 1, in) == 1 &&
+                        std::equal(std::begin(kMagic), std::end(kMagic), header.magic) &&
+                        header.version == kVersion;
+        if (!headerOk || header.fingerprint != fingerprint)
+        {
+            std::fclose(in);
+            std::cerr << "[Resume] Dziennik '" << m_path.string()
+                      << (headerOk ? "' pochodzi z innych ustawień symulacji"
+                                   : "' jest uszkodzony lub ma nieznany format")
+                      << "; usuń go albo uruchom skan bez --resume" << std::endl;
+            return false;
+        }
+
+        goodSize = sizeof(header);
+        Record record;
+        while (std::fread(&record, sizeof(record), 1, in) == 1 && record.checksum == RecordChecksum(record))
+        {
+            m_done[record.key] = record.result;
+            goodSize += sizeof(record);
+        }
+        std::fclose(in);
+        std::cout << "[Resume] Wczytano " << m_done.size() << " policzonych punktów z dziennika "
+                  << m_path.string() << std::endl;
+        return true;
+    }
+
+    bool Sync()
+    {
+        return std::fflush(m_file) == 0 && fsync(fileno(m_file)) == 0;
+    }
+
+    void Close()
+    {
+        if (m_file)
+        {
+            std::fclose(m_file);
+            m_file = nullptr;
+        }
+    }
+
+    fs::path m_path;
+    std::FILE* m_file = nullptr;
+    std::map<Key, SimulationResult> m_done;
+};
+
+// Trwała pamięć wyników RunScenario() między uruchomieniami (--cacheDir). Każdy symulowany punkt
+// to osobny plik nazwany 128-bitowym skrótem wszystkiego, od czego zależy wynik: pozycji,
+// wiersza tabeli dielektrycznej organu, liczby warstw i odcisku ScenarioFingerprint (liczby
+// pakietów, moc TX, wzmocnienie jammera, czułość, odstęp pakietów, jammery) z wersją formatu.
+// Powtórzony lub poszerzony skan liczy więc tylko nowe punkty. Odczyt odświeża czas modyfikacji
+// pliku, a po przekroczeniu limitu rozmiaru usuwane są najdawniej używane wpisy (LRU).
+// Zapisuje tylko rodzic (wyniki workerów są scalane przed Store), przez plik tymczasowy i rename.
+class ResultCache
+{
+public:
+    bool Open(const fs::path& dir, uint64_t maxBytes, uint64_t fingerprint)
+    {
+        m_dir = dir;
+        m_maxBytes = maxBytes;
+        m_fingerprint = fingerprint ^ kVersion;
+        std::error_code ec;
+        fs::create_directories(m_dir, ec);
+        if (ec)
+        {
+            std::cerr << "[Cache] Nie można utworzyć katalogu '" << m_dir.string() << "': " << ec.message()
+                      << std::endl;
+            return false;
+        }
+        for (const auto& entry : fs::recursive_directory_iterator(m_dir, ec))
+        {
+            if (entry.is_regular_file(ec) && entry.path().extension() == ".res")
+            {
+                m_totalBytes += entry.file_size(ec);
+            }
+        }
+        m_initialBytes = m_totalBytes;
+        return true;
+    }
+
+    // Wymaga ctx.bodyLoss z docelowymi liczbami warstw (organ jest brany z config).
+    bool Lookup(const SimulationContext& ctx, const SimulationConfig& config, SimulationResult& result)
+    {
+        const Key key = MakeKey(ctx, config);
+        const fs::path path = PathOf(key);
+        Entry entry;
+        std::FILE* in = std::fopen(path.c_str(), "rb");
+        bool hit = false;
+        if (in)
+        {
+            hit = std::fread(&entry, sizeof(entry), 1, in) == 1 &&
+                  std::equal(std::begin(kMagic), std::end(kMagic), entry.magic) && entry.key == key &&
+                  SameConfig(entry.config, config) &&
+                  entry.checksum == EntryChecksum(entry);
+            std::fclose(in);
+        }
+        if (!hit)
+        {
+            ++m_misses;
+            return false;
+        }
+        std::error_code ec;
+        fs::last_write_time(path, fs::file_time_type::clock::now(), ec);
+        result = entry.result;
+        ++m_hits;
+        return true;
+    }
+
+    void Store(const SimulationContext& ctx, const SimulationConfig& config, const SimulationResult& result)
+    {
+        if (result.analytic || result.deduplicated)
+        {
+            return;
+        }
+        Entry entry = Entry();
+        std::copy(std::begin(kMagic), std::end(kMagic), entry.magic);
+        entry.key = MakeKey(ctx, config);
+        entry.config = config;
+        entry.result = result;
+        entry.checksum = EntryChecksum(entry);
+
+        const fs::path path = PathOf(entry.key);
+        std::error_code ec;
+        fs::create_directories(path.parent_path(), ec);
+        fs::path temporary = path;
+        temporary += ".tmp";
+        std::FILE* out = std::fopen(temporary.c_str(), "wb");
+        if (!out)
+        {
+            return;
+        }
+        const bool written = std::fwrite(&entry, sizeof(entry), 1, out) == 1;
+        if (std::fclose(out) != 0 || !written)
+        {
+            fs::remove(temporary, ec);
+            return;
+        }
+        const bool replaced = fs::exists(path, ec);
+        fs::rename(temporary, path, ec);
+        if (ec)
+        {
+            fs::remove(temporary, ec);
+            return;
+        }
+        ++m_stored;
+        m_bytesStored += sizeof(entry);
+        m_totalBytes += replaced ? 0 : sizeof(entry);
+        if (m_totalBytes > m_maxBytes)
+        {
+            Evict();
+        }
+    }
+
+    void Report() const
+    {
+        const uint64_t lookups = m_hits + m_misses;
+        std::cout << "[Cache] Trafienia " << m_hits << " z " << lookups << " ("
+                  << (lookups ? 100.0 * m_hits / lookups : 0.0) << "%), zapisano " << m_stored << " wyników ("
+                  << m_bytesStored << " B), katalog " << m_initialBytes << " -> " << m_totalBytes << " B (limit "
+                  << m_maxBytes << " B), usunięto " << m_evicted << " wpisów" << std::endl;
+    }
+
+private:
+    using Key = std::array<uint64_t, 2>;
+
+    static constexpr char kMagic[8] = {'W', 'B', 'A', 'N', 'C', 'A', 'C', 'H'};
+    static constexpr uint64_t kVersion = 3;
+
+    struct Entry
+    {
+        char magic[8];
+        Key key;
+        SimulationConfig config;
+        SimulationResult result;
+        uint64_t checksum;
+    };
+
+    Key MakeKey(const SimulationContext& ctx, const SimulationConfig& config) const
+    {
+        struct
+        {
+            double positions[7];
+            BodyDielectricParameters organ;
+            double fatLayer;
+            double muscleLayer;
+            double replication;
+            double jamBoostDb;
+        } input;
+        std::memset(&input, 0, sizeof(input));
+        const double positions[] = {config.txX, config.txY, config.rxX, config.rxY,
+                                    config.jamX, config.jamY, config.jamZ};
+        std::copy(std::begin(positions), std::end(positions), input.positions);
+        input.organ = BodyPropagationLossModel::GetDielectricParameters(config.organOption);
+        input.fatLayer = ctx.bodyLoss->GetFatLayer();
+        input.muscleLayer = ctx.bodyLoss->GetMuscleLayer();
+        input.replication = config.replication;
+        input.jamBoostDb = config.jamBoostDb;
+        return Key{HashBytes(&input, sizeof(input), m_fingerprint),
+                   HashBytes(&input, sizeof(input), ~m_fingerprint * 0x9e3779b97f4a7c15ULL)};
+    }
+
+    fs::path PathOf(const Key& key) const
+    {
+        char name[40];
+        std::snprintf(name, sizeof(name), "%016llx%016llx.res",
+                      static_cast<unsigned long long>(key[0]), static_cast<unsigned long long>(key[1]));
+        return m_dir / std::string(name, 2) / name;
+    }
+
+    static bool SameConfig(const SimulationConfig& a, const SimulationConfig& b)
+    {
+        return a.txX == b.txX && a.txY == b.txY && a.rxX == b.rxX && a.rxY == b.rxY && a.jamX == b.jamX &&
+               a.jamY == b.jamY && a.jamZ == b.jamZ && a.organOption == b.organOption &&
+               a.replication == b.replication && a.jamBoostDb == b.jamBoostDb;
+    }
+
+    static uint64_t EntryChecksum(const Entry& entry)
+    {
+        return HashBytes(&entry, offsetof(Entry, checksum), sizeof(Entry));
+    }
+
+    // Usuwa najdawniej używane wpisy, aż katalog zajmie najwyżej 90% limitu (zapas, żeby nie
+    // przeglądać katalogu przy każdym kolejnym zapisie).
+    void Evict()
+    {
+        std::vector<std::pair<fs::file_time_type, fs::path>> entries;
+        std::error_code ec;
+        uint64_t total = 0;
+        for (const auto& entry : fs::recursive_directory_iterator(m_dir, ec))
+        {
+            if (entry.is_regular_file(ec) && entry.path().extension() == ".res")
+            {
+                entries.emplace_back(entry.last_write_time(ec), entry.path());
+                total += entry.file_size(ec);
+            }
+        }
+        std::sort(entries.begin(), entries.end());
+        const uint64_t target = m_maxBytes / 10 * 9;
+        for (const auto& [time, path] : entries)
+        {
+            if (total <= target)
+            {
+                break;
+            }
+            const uint64_t size = fs::file_size(path, ec);
+            if (fs::remove(path, ec))
+            {
+                total -= ec ? 0 : size;
+                ++m_evicted;
+            }
+        }
+        m_totalBytes = total;
+    }
+
+    fs::path m_dir;
+    uint64_t m_maxBytes = 0;
+    uint64_t m_fingerprint = 0;
+    uint64_t m_totalBytes = 0;   //!< rozmiar wpisów w katalogu
+    uint64_t m_initialBytes = 0; //!< rozmiar wpisów przy Open
+    uint64_t m_hits = 0;
+    uint64_t m_misses = 0;
+    uint64_t m_stored = 0;
+    uint64_t m_bytesStored = 0;
+    uint64_t m_evicted = 0;
+};
+
+// --profile: domyślny MapScheduler z licznikiem zdarzeń w kolejce (ns-3 nie udostępnia jej
+// rozmiaru). Anulowane zdarzenia zostają w kolejce do chwili zdjęcia, tak jak w MapScheduler.
+class ProfilingScheduler : public MapScheduler
+{
+public:
+    static TypeId GetTypeId()
+    {
+        static TypeId tid = TypeId("ns3::WbanJammingProfilingScheduler")
+                                .SetParent<MapScheduler>()
+                                .SetGroupName("Wban")
+                                .AddConstructor<ProfilingScheduler>();
+        return tid;
+    }
+
+    void Insert(const Event& ev) override
+    {
+        MapScheduler::Insert(ev);
+        g_eventQueuePeak = std::max(g_eventQueuePeak, ++g_eventQueueDepth);
+    }
+
+    Event RemoveNext() override
+    {
+        --g_eventQueueDepth;
+        return MapScheduler::RemoveNext();
+    }
+
+    void Remove(const Event& ev) override
+    {
+        MapScheduler::Remove(ev);
+        --g_eventQueueDepth;
+    }
+};
+
+// --profile: sumy czasu (ściana i CPU wątku) dla faz przebiegu, statystyki DES i pomiary
+// każdego punktu skanu, zapisywane na końcu jako JSON. Punkty liczone w workerach przynoszą
+// swoje pomiary w SimulationResult.
+class ScanProfile
+{
+public:
+    ScanProfile()
+        : m_start(ProfileSample::Now())
+    {
+    }
+
+    void AddPhase(const std::string& name, double wallSec, double cpuSec)
+    {
+        auto it = std::find_if(m_phases.begin(), m_phases.end(), [&name](const auto& phase) {
+            return phase.first == name;
+        });
+        if (it == m_phases.end())
+        {
+            it = m_phases.insert(m_phases.end(), {name, Phase()});
+        }
+        it->second.wallSec += wallSec;
+        it->second.cpuSec += cpuSec;
+        ++it->second.calls;
+    }
+
+    // Faza od begin do teraz (w bieżącym wątku).
+    void AddPhase(const std::string& name, const ProfileSample& begin)
+    {
+        ProfileSample end = ProfileSample::Now();
+        AddPhase(name, end.wallSec - begin.wallSec, end.cpuSec - begin.cpuSec);
+    }
+
+    // source: des, analytic, journal lub dedup; tylko punkty "des" były symulowane w tym przebiegu.
+    void AddPoint(const SimulationResult& result, const char* source)
+    {
+        m_points.push_back(Point{result.organOption,
+                                 source,
+                                 {result.txX, result.txY},
+                                 {result.rxX, result.rxY},
+                                 {result.jamX, result.jamY, result.jamZ},
+                                 result.scheduleWallSec,
+                                 result.scheduleCpuSec,
+                                 result.runWallSec,
+                                 result.runCpuSec,
+                                 result.events,
+                                 result.eventQueuePeak});
+        if (std::strcmp(source, "des") != 0)
+        {
+            return;
+        }
+        AddPhase("schedule", result.scheduleWallSec, result.scheduleCpuSec);
+        AddPhase("run", result.runWallSec, result.runCpuSec);
+        m_events += result.events;
+        m_runWallSec += result.runWallSec;
+        m_eventQueuePeak = std::max(m_eventQueuePeak, result.eventQueuePeak);
+        m_templateCopies += result.packetCopies;
+        m_heapAllocations += result.heapAllocations;
+    }
+
+    void AddCsv(const CsvSink& csv);
+
+    bool Write(const fs::path& path) const
+    {
+        std::ofstream out(path, std::ios::out | std::ios::trunc);
+        if (!out.is_open())
+        {
+            return false;
+        }
+        out << std::setprecision(9);
+        out << "{\n  \"wallSec\": " << ProfileSample::Now().wallSec - m_start.wallSec << ",\n";
+        out << "  \"phases\": {";
+        for (size_t i = 0; i < m_phases.size(); ++i)
+        {
+            const Phase& phase = m_phases[i].second;
+            out << (i ? ",\n" : "\n") << "    \"" << m_phases[i].first << "\": {\"wallSec\": " << phase.wallSec
+                << ", \"cpuSec\": " << phase.cpuSec << ", \"calls\": " << phase.calls << "}";
+        }
+        out << "\n  },\n";
+        out << "  \"events\": {\"executed\": " << m_events
+            << ", \"perSec\": " << (m_runWallSec > 0.0 ? m_events / m_runWallSec : 0.0)
+            << ", \"peakQueueDepth\": " << m_eventQueuePeak << "},\n";
+        out << "  \"templateCopies\": " << m_templateCopies << ",\n";
+        out << "  \"heapAllocations\": " << m_heapAllocations << ",\n";
+        out << "  \"csvBytesWritten\": " << m_csvBytes << ",\n";
+        out << "  \"points\": [";
+        for (size_t i = 0; i < m_points.size(); ++i)
+        {
+            const Point& p = m_points[i];
+            out << (i ? ",\n" : "\n") << "    {\"organ\": \"" << BodyOrganOptionToString(p.organ)
+                << "\", \"source\": \"" << p.source << "\", \"tx\": [" << p.tx[0] << ", " << p.tx[1]
+                << "], \"rx\": [" << p.rx[0] << ", " << p.rx[1] << "], \"jam\": [" << p.jam[0] << ", "
+                << p.jam[1] << ", " << p.jam[2] << "], \"scheduleWallSec\": " << p.scheduleWallSec
+                << ", \"scheduleCpuSec\": " << p.scheduleCpuSec << ", \"runWallSec\": " << p.runWallSec
+                << ", \"runCpuSec\": " << p.runCpuSec << ", \"events\": " << p.events
+                << ", \"peakQueueDepth\": " << p.eventQueuePeak << "}";
+        }
+        out << (m_points.empty() ? "]\n}\n" : "\n  ]\n}\n");
+        out.close();
+        return !out.fail();
+    }
+
+private:
+    struct Phase
+    {
+        double wallSec = 0.0;
+        double cpuSec = 0.0;
+        uint64_t calls = 0;
+    };
+
+    struct Point
+    {
+        BodyOrganOption organ;
+        const char* source;
+        double tx[2];
+        double rx[2];
+        double jam[3];
+        double scheduleWallSec;
+        double scheduleCpuSec;
+        double runWallSec;
+        double runCpuSec;
+        uint64_t events;
+        uint64_t eventQueuePeak;
+    };
+
+    ProfileSample m_start;
+    std::vector<std::pair<std::string, Phase>> m_phases; //!< w kolejności pierwszego wystąpienia
+    std::vector<Point> m_points;
+    uint64_t m_events = 0;
+    double m_runWallSec = 0.0;
+    uint64_t m_eventQueuePeak = 0;
+    uint64_t m_templateCopies = 0;  //!< kopie szablonu pakietu (po jednej na wysłanie)
+    uint64_t m_heapAllocations = 0; //!< operator new zliczony w Simulator::Run()
+    uint64_t m_csvBytes = 0;
+};
+
+void
+ScanProfile::AddCsv(const CsvSink& csv)
+{
+    AddPhase("csvWrite", csv.GetWriteWallSeconds(), csv.GetWriteCpuSeconds());
+    m_csvBytes += csv.GetBytesWritten();
+}
+
+// Każde źródło wysyła kopie jednego, raz oznaczonego pakietu. Packet::Copy() współdzieli bufor
+// i listę tagów (copy-on-write) oraz zachowuje UID, więc wysyłka nie alokuje bufora ani tagu,
+// a źródło pakietu przy odbiorze rozpoznajemy po UID bez przeszukiwania listy tagów.
+void
+CreatePacketTemplates(SimulationContext& ctx)
+{
+    ctx.txTemplate = Create<Packet>(kPayloadBytes);
+    ctx.txTemplate->AddPacketTag(SrcTag(SrcTag::TX));
+    ctx.jamTemplate = Create<Packet>(32);
+    ctx.jamTemplate->AddPacketTag(SrcTag(SrcTag::JAM));
+    ctx.txPacketUid = ctx.txTemplate->GetUid();
+    ctx.jamPacketUid = ctx.jamTemplate->GetUid();
+}
+
+void RxIndication(SimulationContext* context, uint32_t psduLength, Ptr<Packet> p, uint8_t packetSize)
+{
+    SimulationContext& ctx = *context;
+    SrcTag::SrcType src;
+    if (p->GetUid() == ctx.txPacketUid) {
+        src = SrcTag::TX;
+    } else if (p->GetUid() == ctx.jamPacketUid) {
+        src = SrcTag::JAM;
+    } else {
+        // PHY podmienił pakiet (inny UID) - wracamy do odczytu tagu.
+        SrcTag tag;
+        ++ctx.counters.tagLookups;
+        if (!p->PeekPacketTag(tag)) {
+            return;
+        }
+        src = tag.Get();
+    }
+
+    if (ctx.counters.jammingActive) {
+        if (src == SrcTag::TX) ctx.counters.jamRxTx++;
+        else ctx.counters.jamRxJam++;
+    } else {
+        ctx.counters.noJamRx++;
+    }
+}
+// t   r       j
+
+// Przy zaciemnieniu każdy punkt (i replikacja) dostaje własny run generatora wyprowadzony z
+// RngRun i konfiguracji, a AssignStreams() tworzy od nowa zmienne losowe łańcucha strat
+// (NormalRandomVariable losuje parami i pamięta drugą wartość, której SetStream() nie kasuje)
+// i kasuje zaciemnienie wylosowane dla łączy. Każde łącze losuje zaciemnienie raz na punkt,
+// przy pierwszym pakiecie, a kolejne pakiety punktu widzą tę samą wartość. Losowania punktu nie zależą więc od tego, które punkty ten sam proces policzył wcześniej,
+// i wynik jest taki sam przy dowolnej liczbie --jobs. Wzmocnienie jammera nie wchodzi do runu: punkty różniące się
+// tylko mocą jammera dostają te same losowania, więc --scanMode=power porównuje moce na tym
+// samym kanale.
+void
+SeedScenarioStreams(SimulationContext& ctx, const SimulationConfig& config)
+{
+    if (!ctx.parameters.IsStochastic())
+    {
+        return;
+    }
+    const double values[] = {config.txX, config.txY, config.rxX, config.rxY,
+                             config.jamX, config.jamY, config.jamZ,
+                             static_cast<double>(config.organOption),
+                             static_cast<double>(config.replication)};
+    RngSeedManager::SetRun(HashBytes(values, sizeof(values), ctx.parameters.baseRun));
+    Ptr<PropagationLossModel> head = ctx.shadowing ? Ptr<PropagationLossModel>(ctx.shadowing)
+                                                   : Ptr<PropagationLossModel>(ctx.pathLoss);
+    head->AssignStreams(0);
+}
+
+void
+PrepareScenario(SimulationContext& ctx, const SimulationConfig& config, SimulationResult& result)
+{
+    SeedScenarioStreams(ctx, config);
+    ctx.bodyLoss->SetBodyOptions(config.organOption);
+    ctx.mTx->SetPosition(Vector(config.txX, config.txY, 0));
+    ctx.mRx->SetPosition(Vector(config.rxX, config.rxY, 0));
+    ctx.mJam->SetPosition(Vector(config.jamX, config.jamY, config.jamZ));
+    ApplyJamBoost(ctx, config.jamBoostDb);
+    UpdateActiveJammers(ctx);
+    result.activeJammers = static_cast<uint32_t>(ctx.activeJammers.size());
+
+    // Budżet łącza w wyniku to wartości średnie: liczone bez zaciemnienia (BatchLinkBudget SCALAR
+    // daje te same liczby co CalcRxPower), więc przy --shadowingSigmaDb/--bodyShadowingSigmaDb
+    // nie są pojedynczym losowaniem i nie zużywają liczb ze strumieni punktu.
+    const double txPowerDbm = ctx.parameters.txPowerDbm;
+    const double jamPowerDbm = txPowerDbm + config.jamBoostDb;
+    result.bodyLossDb = ctx.bodyLoss->GetLinkBodyLossDb(ctx.mTx, ctx.mRx);
+    result.bodyRxPowerDbm = txPowerDbm - result.bodyLossDb;
+    BatchLinkBudget jamBudget(ctx.pathLoss, ctx.bodyLoss->GetLinkBodyLossDb(ctx.mJam, ctx.mRx));
+    jamBudget.SetKernel(BatchLinkBudget::Kernel::SCALAR);
+    const double jamX = config.jamX;
+    const double jamY = config.jamY;
+    const double jamZ = config.jamZ;
+    jamBudget.CalcRxPower(jamPowerDbm, PositionArrays{&jamX, &jamY, &jamZ}, ctx.mRx->GetPosition(), 1,
+                          &result.jamRxPowerDbm);
+    result.jamLossDb = jamPowerDbm - result.jamRxPowerDbm;
+    result.params = ctx.bodyLoss->m_parameters;
+    result.txX = config.txX;
+    result.txY = config.txY;
+    result.rxX = config.rxX;
+    result.rxY = config.rxY;
+    result.jamX = config.jamX;
+    result.jamY = config.jamY;
+    result.jamZ = config.jamZ;
+    result.organOption = config.organOption;
+    result.jamBoostDb = config.jamBoostDb;
+}
+
+// Wymaga ctx.bodyLoss ustawionego już na organ z config (jak po PrepareScenario), bo liczby
+// warstw pochodzą z modelu.
+NoJamPhaseKey
+MakeNoJamPhaseKey(const SimulationContext& ctx, const SimulationConfig& config)
+{
+    NoJamPhaseKey key{};
+    const double positions[] = {config.txX, config.txY, config.rxX, config.rxY};
+    std::memcpy(key.data(), positions, sizeof(positions));
+    key[4] = static_cast<uint64_t>(config.organOption);
+    key[5] = ctx.bodyLoss->GetFatLayer();
+    key[6] = ctx.bodyLoss->GetMuscleLayer();
+    return key;
+}
+
+// Wymaga ctx.bodyLoss ustawionego na organ z config, jak MakeNoJamPhaseKey.
+ScanSignature
+MakeScanSignature(const SimulationContext& ctx, const SimulationConfig& config)
+{
+    const double txRx = std::hypot(config.rxX - config.txX, config.rxY - config.txY);
+    const double jamRx = std::sqrt((config.rxX - config.jamX) * (config.rxX - config.jamX) +
+                                   (config.rxY - config.jamY) * (config.rxY - config.jamY) +
+                                   config.jamZ * config.jamZ);
+    return ScanSignature{std::llround(txRx * 1e6),
+                         std::llround(jamRx * 1e6),
+                         static_cast<int64_t>(config.organOption),
+                         static_cast<int64_t>(ctx.bodyLoss->GetFatLayer()),
+                         static_cast<int64_t>(ctx.bodyLoss->GetMuscleLayer()),
+                         std::llround(config.jamBoostDb * 1e6)};
+}
+
+// Wynik dla config zbudowany z punktu o tej samej sygnaturze: pozycje i budżet łącza liczone
+// dla config (PrepareScenario), liczniki pakietów i przedziały skopiowane ze źródła.
+SimulationResult
+CopySimulatedResult(SimulationContext& ctx, const SimulationResult& source, const SimulationConfig& config)
+{
+    SimulationResult result;
+    PrepareScenario(ctx, config, result);
+    result.noJamSent = source.noJamSent;
+    result.noJamRx = source.noJamRx;
+    result.jamSentTx = source.jamSentTx;
+    result.jamRxTx = source.jamRxTx;
+    result.jamSentJam = source.jamSentJam;
+    result.jamRxJam = source.jamRxJam;
+    result.noJamCiLow = source.noJamCiLow;
+    result.noJamCiHigh = source.noJamCiHigh;
+    result.jamCiLow = source.jamCiLow;
+    result.jamCiHigh = source.jamCiHigh;
+    result.analytic = source.analytic;
+    result.deduplicated = true;
+    return result;
+}
+
+// Zostawia w remaining po jednym punkcie na sygnaturę. Punkty o sygnaturze policzonej we
+// wcześniejszej partii (ctx.dedupCache) dostają wynik od razu, pozostałe duplikaty trafiają do
+// copies jako (punkt, reprezentant) i są uzupełniane po symulacji reprezentantów.
+void
+PlanDedup(SimulationContext& ctx,
+          const std::vector<SimulationConfig>& configs,
+          std::vector<size_t>& remaining,
+          std::vector<SimulationResult>& results,
+          std::vector<std::pair<size_t, size_t>>& copies,
+          std::map<ScanSignature, size_t>& representatives)
+{
+    std::vector<size_t> unique;
+    for (size_t index : remaining)
+    {
+        ctx.bodyLoss->SetBodyOptions(configs[index].organOption);
+        ScanSignature signature = MakeScanSignature(ctx, configs[index]);
+        auto cached = ctx.dedupCache.find(signature);
+        if (cached != ctx.dedupCache.end())
+        {
+            results[index] = CopySimulatedResult(ctx, cached->second, configs[index]);
+            continue;
+        }
+        auto [it, inserted] = representatives.emplace(signature, index);
+        if (inserted)
+        {
+            unique.push_back(index);
+        }
+        else
+        {
+            copies.emplace_back(index, it->second);
+        }
+    }
+    remaining.swap(unique);
+}
+
+// Przed rozdzieleniem punktów między workery rodzic liczy po jednym pełnym punkcie dla każdego
+// klucza fazy 1 wspólnego dla kilku punktów, więc workery dziedziczą gotową fazę 1.
+// Przy jednym procesie pamięć podręczna zapełnia się sama przy pierwszym punkcie.
+void
+SeedNoJamCache(SimulationContext& ctx,
+               const std::vector<SimulationConfig>& configs,
+               uint32_t jobs,
+               std::vector<size_t>& remaining,
+               std::vector<SimulationResult>& results,
+               std::vector<size_t>& seeded)
+{
+    if (!ctx.parameters.reuseNoJamPhase || jobs <= 1 || remaining.size() <= 1)
+    {
+        return;
+    }
+    std::map<NoJamPhaseKey, std::vector<size_t>> byKey;
+    for (size_t index : remaining)
+    {
+        ctx.bodyLoss->SetBodyOptions(configs[index].organOption);
+        byKey[MakeNoJamPhaseKey(ctx, configs[index])].push_back(index);
+    }
+    for (const auto& [key, indices] : byKey)
+    {
+        if (indices.size() >= 2 && ctx.noJamCache.find(key) == ctx.noJamCache.end())
+        {
+            results[indices.front()] = RunScenario(ctx, configs[indices.front()], false);
+            seeded.push_back(indices.front());
+        }
+    }
+    std::sort(seeded.begin(), seeded.end());
+    remaining.erase(std::remove_if(remaining.begin(),
+                                   remaining.end(),
+                                   [&seeded](size_t index) {
+                                       return std::binary_search(seeded.begin(), seeded.end(), index);
+                                   }),
+                    remaining.end());
+}
+
+// Moce odbierane po pathLoss dla wszystkich punktów partii naraz (wektorowo, bez obiektów
+// mobilności). Zgodne z ctx.pathLoss->CalcRxPower z dokładnością BatchLinkBudget::TOLERANCE_DB.
+// Strata LogDistance nie zależy od mocy nadawania, więc wzmocnienie jammera każdego punktu
+// dodajemy po obliczeniu partii.
+void
+CalcPathRxPowers(SimulationContext& ctx,
+                 const std::vector<SimulationConfig>& configs,
+                 std::vector<double>& txRxPathDbm,
+                 std::vector<double>& jamPathDbm)
+{
+    const size_t n = configs.size();
+    std::vector<double> txX(n), txY(n), rxX(n), rxY(n), jamX(n), jamY(n), jamZ(n);
+    const std::vector<double> zero(n, 0.0);
+    for (size_t i = 0; i < n; ++i)
+    {
+        txX[i] = configs[i].txX;
+        txY[i] = configs[i].txY;
+        rxX[i] = configs[i].rxX;
+        rxY[i] = configs[i].rxY;
+        jamX[i] = configs[i].jamX;
+        jamY[i] = configs[i].jamY;
+        jamZ[i] = configs[i].jamZ;
+    }
+
+    BatchLinkBudget budget(ctx.pathLoss, 0.0);
+    txRxPathDbm.resize(n);
+    jamPathDbm.resize(n);
+    budget.CalcRxPower(ctx.parameters.txPowerDbm,
+                       PositionArrays{txX.data(), txY.data(), zero.data()},
+                       PositionArrays{rxX.data(), rxY.data(), zero.data()},
+                       n,
+                       txRxPathDbm.data());
+    budget.CalcRxPower(ctx.parameters.txPowerDbm,
+                       PositionArrays{jamX.data(), jamY.data(), jamZ.data()},
+                       PositionArrays{rxX.data(), rxY.data(), zero.data()},
+                       n,
+                       jamPathDbm.data());
+    for (size_t i = 0; i < n; ++i)
+    {
+        jamPathDbm[i] += configs[i].jamBoostDb;
+    }
+}
+
+// Klasyfikacja punktu wyłącznie z budżetu łącza. Kanał nie ma fadingu, więc o odbiorze decyduje
+// czułość rxSensitivityDbm oraz stosunek sygnału do zakłóceń. Pakiety jammera startują w tej samej
+// chwili co pakiety TX i są kolejkowane wcześniej, więc jammer powyżej czułości zajmuje odbiornik.
+// Punkty w pasie marginDb wokół progów zależą od szczegółów PHY i zwracamy je jako niepewne.
+// txRxPathDbm/jamPathDbm to moce po samym pathLoss z CalcPathRxPowers; tłumienie ciała
+// dokładamy tu per-call, bo zależy od organu i rejestracji mobilności w ciele.
+bool
+PredictScenario(SimulationContext& ctx,
+                const SimulationConfig& config,
+                double txRxPathDbm,
+                double jamPathDbm,
+                double marginDb,
+                SimulationResult& result)
+{
+    PrepareScenario(ctx, config, result);
+
+    const double txRxDbm = ctx.bodyLoss->CalcRxPower(txRxPathDbm, ctx.mTx, ctx.mRx);
+    const double jamDbm = ctx.bodyLoss->CalcRxPower(jamPathDbm, ctx.mJam, ctx.mRx);
+    const double sensitivityDbm = ctx.parameters.rxSensitivityDbm;
+    // pas marginDb po obu stronach czułości: moc zintegrowana przez PHY może się nieco różnić
+    // od budżetu analitycznego, więc punkty w pasie liczy symulacja
+    const bool txLost = txRxDbm < sensitivityDbm - marginDb;
+    const bool txClear = txRxDbm >= sensitivityDbm + marginDb;
+
+    // Faza 1: tylko TX.
+    if (!txLost && !txClear)
+    {
+        return false;
+    }
+    result.noJamSent = ctx.parameters.noJamPackets;
+    result.noJamRx = txClear ? ctx.parameters.noJamPackets : 0;
+
+    // Faza 2: TX + jammer.
+    result.jamSentTx = ctx.parameters.withJamPackets;
+    result.jamSentJam = ctx.parameters.withJamPackets;
+    if (jamDbm < sensitivityDbm - marginDb)
+    {
+        result.jamRxJam = 0;
+        if (txLost)
+        {
+            result.jamRxTx = 0;
+        }
+        else if (txRxDbm - jamDbm >= marginDb)
+        {
+            result.jamRxTx = ctx.parameters.withJamPackets;
+        }
+        else
+        {
+            return false;
+        }
+    }
+    else if (jamDbm >= sensitivityDbm + marginDb && jamDbm - txRxDbm >= marginDb)
+    {
+        result.jamRxTx = 0;
+        result.jamRxJam = ctx.parameters.withJamPackets;
+    }
+    else
+    {
+        return false;
+    }
+
+    result.analytic = true;
+    result.noJamCiLow = result.noJamCiHigh = result.noJamRx ? 1.0 : 0.0;
+    result.jamCiLow = result.jamCiHigh = result.jamRxTx ? 1.0 : 0.0;
+    return true;
+}
+
+SimulationResult
+RunScenario(SimulationContext& ctx, const SimulationConfig& config, bool enableLogs)
+{
+    ctx.counters = ScenarioCounters();
+    const ProfileSample scheduleBegin = ctx.profile ? ProfileSample::Now() : ProfileSample();
+    SimulationResult result;
+    PrepareScenario(ctx, config, result);
+    const double bodyRxPowerDbm = result.bodyRxPowerDbm;
+    const double bodyLossDb = result.bodyLossDb;
+    const double jamRxPowerDbm = result.jamRxPowerDbm;
+    const double jamLossDb = result.jamLossDb;
+    const BodyDielectricParameters& params = result.params;
+
+    if (enableLogs)
+    {
+        std::cout << "[BodyPropagationLossModel] organ="
+                  << BodyOrganOptionToString(config.organOption)
+                  << " DoCalcRxPower(txPowerDbm=" << ctx.parameters.txPowerDbm
+                  << ", txPos=" << ctx.mTx->GetPosition()
+                  << ", rxPos=" << ctx.mRx->GetPosition()
+                  << ") = " << bodyRxPowerDbm << " dBm" << std::endl;
+        std::cout << "    -> attenuation due to body = " << bodyLossDb << " dB" << std::endl;
+        std::cout << "    -> jammer path rxPower = " << jamRxPowerDbm << " dBm" << std::endl;
+        std::cout << "    -> jammer path loss = " << jamLossDb << " dB" << std::endl;
+        std::cout << "    -> dielectric params: organConductivity=" << params.organConductivity
+                  << ", organPermittivity=" << params.organPermittivity
+                  << ", skinConductivity=" << params.skinConductivity
+                  << ", skinPermittivity=" << params.skinPermittivity << std::endl;
+    }
+
+    const bool logProgress = enableLogs;
+
+    const NoJamPhaseKey noJamKey = MakeNoJamPhaseKey(ctx, config);
+    const NoJamPhaseResult* noJamCached = nullptr;
+    if (ctx.parameters.reuseNoJamPhase)
+    {
+        auto it = ctx.noJamCache.find(noJamKey);
+        if (it != ctx.noJamCache.end())
+        {
+            noJamCached = &it->second;
+        }
+    }
+
+    Simulator::Schedule(Seconds(0.2), [&, logProgress]() {
+        if (logProgress)
+        {
+            std::cout << "=== FAZA 1: BEZ jammingu ===\n";
+        }
+        ctx.txDev->GetPhy()->PhySetTRXStateRequest(WbanPhyState::PHY_TX_ON);
+        ctx.rxDev->GetPhy()->PhySetTRXStateRequest(WbanPhyState::PHY_RX_ON);
+        ctx.counters.jammingActive = false;
+    });
+
+    const Time pktGap = Seconds(kPktGapSeconds);
+    const double noJamZ = ctx.parameters.earlyStop.enabled ? EarlyStopZ(ctx.parameters.earlyStop, ctx.parameters.noJamPackets) : 0.0;
+    const double jamZ = ctx.parameters.earlyStop.enabled ? EarlyStopZ(ctx.parameters.earlyStop, ctx.parameters.withJamPackets) : 0.0;
+    // Sprawdzenie przy wysyłce pakietu i: wyniki pakietów 0..i-1 są już znane (odstęp
+    // kPktGapSeconds jest dłuższy niż czas nadawania), a zgubione pakiety nie dają RxIndication.
+    // Faza 2 kończy się, gdy przedział rozstrzyga isJammed. Skuteczność fazy 1 nie jest
+    // porównywana z jamThreshold, więc fazę 1 kończymy dopiero przy zadanej szerokości przedziału.
+    auto shouldStop = [&ctx](uint32_t i, uint32_t rx, uint32_t sent, double z, bool noJamPhase) {
+        const EarlyStopOptions& earlyStop = ctx.parameters.earlyStop;
+        return earlyStop.enabled && i > 0 && i % earlyStop.batch == 0 &&
+               (noJamPhase ? IsRatePrecise(earlyStop, rx, sent, z) : IsRateDecided(earlyStop, rx, sent, z));
+    };
+
+    TrafficSource noJamTxSource;
+    TrafficSource jamSource;
+    TrafficSource jamTxSource;
+    EventId phase2Event;
+
+    auto startPhase2 = [&, logProgress](Time delay) {
+        phase2Event.Cancel();
+        phase2Event = Simulator::Schedule(delay, [&, logProgress]() {
+            if (logProgress)
+            {
+                std::cout << "\n=== FAZA 2: Z jammerem ===\n";
+            }
+            ctx.jamDev->GetPhy()->PhySetTRXStateRequest(WbanPhyState::PHY_TX_ON);
+            for (uint32_t index : ctx.activeJammers)
+            {
+                ctx.jammers[index].dev->GetPhy()->PhySetTRXStateRequest(WbanPhyState::PHY_TX_ON);
+            }
+            ctx.counters.jammingActive = true;
+        });
+
+        // Jammer startuje przed TX, więc przy równych czasach jego pakiet jest obsługiwany pierwszy.
+        jamSource.Start(delay, pktGap, ctx.parameters.withJamPackets, [&](uint32_t) {
+            ctx.jamDev->GetPhy()->PhyDataRequest(ctx.jamTemplate->GetSize(), ctx.jamTemplate->Copy());
+            ++ctx.counters.packetCopies;
+            ++ctx.counters.jamSentJam;
+            for (uint32_t index : ctx.activeJammers)
+            {
+                ctx.jammers[index].dev->GetPhy()->PhyDataRequest(ctx.jamTemplate->GetSize(),
+                                                                 ctx.jamTemplate->Copy());
+                ++ctx.counters.packetCopies;
+                ++ctx.counters.jamSentJam;
+            }
+        });
+
+        jamTxSource.Start(delay, pktGap, ctx.parameters.withJamPackets, [&, logProgress](uint32_t i) {
+            if (shouldStop(i, ctx.counters.jamRxTx, ctx.counters.jamSentTx, jamZ, false))
+            {
+                // pakiet jammera z tej chwili jest już w kanale, więc dajemy mu jeden odstęp na odbiór
+                jamSource.Stop();
+                jamTxSource.Stop();
+                Simulator::Stop(pktGap);
+                if (logProgress)
+                {
+                    std::cout << "[EarlyStop] Faza 2 rozstrzygnięta po " << ctx.counters.jamSentTx << " pakietach TX\n";
+                }
+                return;
+            }
+            ctx.txDev->GetPhy()->PhyDataRequest(kPayloadBytes, ctx.txTemplate->Copy());
+            ++ctx.counters.packetCopies;
+            ++ctx.counters.jamSentTx;
+            if (logProgress && ((i + 1) % kPrintEvery == 0))
+            {
+                std::cout << "Faza 2: TX wysłano " << (i + 1)
+                          << ", RX odebrał TX " << ctx.counters.jamRxTx
+                          << ", RX odebrał JAM " << ctx.counters.jamRxJam << "\n";
+            }
+        });
+    };
+
+    const double phase2Start = 0.5 + ctx.parameters.noJamPackets * kPktGapSeconds + kGapBetweenPhases;
+    if (noJamCached)
+    {
+        // Kanał jest deterministyczny, a w fazie 1 jammer milczy, więc wynik fazy 1 zależy tylko
+        // od klucza; od razu przechodzimy do fazy 2.
+        ctx.counters.noJamSent = noJamCached->sent;
+        ctx.counters.noJamRx = noJamCached->rx;
+        result.noJamReused = true;
+        if (logProgress)
+        {
+            std::cout << "[NoJamCache] Faza 1 z pamięci: TX wysłane " << ctx.counters.noJamSent << " | RX odebrał "
+                      << ctx.counters.noJamRx << "\n";
+        }
+        startPhase2(Seconds(0.5));
+    }
+    else
+    {
+        noJamTxSource.Start(Seconds(0.5), pktGap, ctx.parameters.noJamPackets, [&, logProgress](uint32_t i) {
+            if (shouldStop(i, ctx.counters.noJamRx, ctx.counters.noJamSent, noJamZ, true))
+            {
+                noJamTxSource.Stop();
+                startPhase2(Seconds(kGapBetweenPhases));
+                if (logProgress)
+                {
+                    std::cout << "[EarlyStop] Faza 1 osiągnęła dokładność po " << ctx.counters.noJamSent << " pakietach TX\n";
+                }
+                return;
+            }
+            ctx.txDev->GetPhy()->PhyDataRequest(kPayloadBytes, ctx.txTemplate->Copy());
+            ++ctx.counters.packetCopies;
+            ++ctx.counters.noJamSent;
+            if (logProgress && ((i + 1) % kPrintEvery == 0))
+            {
+                std::cout << "Faza 1: TX wysłano " << (i + 1)
+                          << ", RX odebrał " << ctx.counters.noJamRx << "\n";
+            }
+        });
+        startPhase2(Seconds(phase2Start));
+    }
+
+    double simStop = phase2Start + ctx.parameters.withJamPackets * kPktGapSeconds + 1.0;
+    EventId stopEvent = Simulator::Stop(Seconds(simStop));
+    ProfileSample runBegin;
+    uint64_t eventsBegin = 0;
+    if (ctx.profile)
+    {
+        runBegin = ProfileSample::Now();
+        eventsBegin = Simulator::GetEventCount();
+        g_eventQueuePeak = g_eventQueueDepth;
+    }
+    const uint64_t allocationsBegin = t_heapAllocations;
+    Simulator::Run();
+    result.heapAllocations = t_heapAllocations - allocationsBegin;
+    if (ctx.profile)
+    {
+        ProfileSample runEnd = ProfileSample::Now();
+        result.scheduleWallSec = runBegin.wallSec - scheduleBegin.wallSec;
+        result.scheduleCpuSec = runBegin.cpuSec - scheduleBegin.cpuSec;
+        result.runWallSec = runEnd.wallSec - runBegin.wallSec;
+        result.runCpuSec = runEnd.cpuSec - runBegin.cpuSec;
+        result.events = Simulator::GetEventCount() - eventsBegin;
+        result.eventQueuePeak = g_eventQueuePeak;
+    }
+    // Po wcześniejszym zatrzymaniu (earlyStop) te zdarzenia zostałyby w kolejce do następnego punktu.
+    stopEvent.Cancel();
+    phase2Event.Cancel();
+
+    if (enableLogs)
+    {
+        std::cout << "\n=== PODSUMOWANIE ===\n";
+        std::cout << "FAZA 1 (bez jammer’a): TX wysłane " << ctx.counters.noJamSent
+                  << " | RX odebrał " << ctx.counters.noJamRx
+                  << " | stracone " << (ctx.counters.noJamSent - ctx.counters.noJamRx) << "\n";
+        std::cout << "FAZA 2 (z jammer’em): TX wysłane " << ctx.counters.jamSentTx
+                  << " | RX odebrał " << ctx.counters.jamRxTx
+                  << " | stracone " << (ctx.counters.jamSentTx - ctx.counters.jamRxTx) << "\n";
+        std::cout << "FAZA 2 (z jammer’em): JAM wysłane " << ctx.counters.jamSentJam
+                  << " | RX odebrał " << ctx.counters.jamRxJam
+                  << " | stracone " << (ctx.counters.jamSentJam - ctx.counters.jamRxJam) << "\n";
+        const uint32_t sends = ctx.counters.packetCopies;
+        std::cout << "PAKIETY: wysłane jako kopie szablonów " << sends << " | alokacje sterty w Simulator::Run() "
+                  << result.heapAllocations << " (" << (sends ? static_cast<double>(result.heapAllocations) / sends : 0.0)
+                  << " na wysyłkę) | odczyty tagów przy odbiorze " << ctx.counters.tagLookups << "\n";
+    }
+
+    result.noJamSent = ctx.counters.noJamSent;
+    result.noJamRx = ctx.counters.noJamRx;
+    result.jamSentTx = ctx.counters.jamSentTx;
+    result.jamRxTx = ctx.counters.jamRxTx;
+    result.jamSentJam = ctx.counters.jamSentJam;
+    result.jamRxJam = ctx.counters.jamRxJam;
+    result.packetCopies = ctx.counters.packetCopies;
+    result.tagLookups = ctx.counters.tagLookups;
+    if (ctx.parameters.reuseNoJamPhase && !noJamCached)
+    {
+        ctx.noJamCache[noJamKey] = NoJamPhaseResult{ctx.counters.noJamSent, ctx.counters.noJamRx};
+    }
+    if (ctx.parameters.earlyStop.enabled)
+    {
+        WilsonInterval(ctx.counters.noJamRx, ctx.counters.noJamSent, noJamZ, result.noJamCiLow, result.noJamCiHigh);
+        WilsonInterval(ctx.counters.jamRxTx, ctx.counters.jamSentTx, jamZ, result.jamCiLow, result.jamCiHigh);
+    }
+
+    return result;
+}
+
+std::vector<double>
+BuildScanPositions(double scanStart, double scanStop, double scanStep)
+{
+    std::vector<double> positions;
+    const double epsilon = scanStep * 0.5;
+    for (double scanPos = scanStart; scanPos <= scanStop + epsilon; scanPos += scanStep)
+    {
+        positions.push_back(scanPos);
+    }
+    return positions;
+}
+
+SimulationConfig
+MakeScanConfig(const SimulationConfig& baseConfig, bool scanJam, double scanPos)
+{
+    SimulationConfig scanConfig = baseConfig;
+    if (scanJam)
+    {
+        scanConfig.jamX = scanPos;
+    }
+    else
+    {
+        scanConfig.rxX = scanPos;
+    }
+    return scanConfig;
+}
+
+// Symulator ns-3 jest globalnym singletonem, więc równoległość realizujemy procesami:
+// każdy worker (fork) ma własną kopię Simulator i SimulationContext, liczy co `workers`-ty
+// punkt i zapisuje surowe wyniki do pliku tymczasowego, który rodzic scala w kolejności skanu.
+// Przy włączonej ścieżce analitycznej do workerów trafiają tylko punkty niepewne.
+bool
+RunScenarioBatch(SimulationContext& ctx,
+                 const std::vector<SimulationConfig>& configs,
+                 const SweepOptions& options,
+                 std::vector<SimulationResult>& results)
+{
+    static_assert(std::is_trivially_copyable_v<SimulationResult>,
+                  "SimulationResult jest przesyłany między procesami jako surowe bajty");
+
+    results.assign(configs.size(), SimulationResult{});
+    const ProfileSample fastPathBegin = ctx.profile ? ProfileSample::Now() : ProfileSample();
+    std::vector<size_t> pending;
+    std::vector<SimulationResult> predicted;
+    std::vector<double> txRxPathDbm;
+    std::vector<double> jamPathDbm;
+    if (options.fastPath != FastPathMode::OFF)
+    {
+        CalcPathRxPowers(ctx, configs, txRxPathDbm, jamPathDbm);
+    }
+    for (size_t i = 0; i < configs.size(); ++i)
+    {
+        SimulationResult prediction;
+        if (options.fastPath != FastPathMode::OFF &&
+            PredictScenario(ctx,
+                            configs[i],
+                            txRxPathDbm[i],
+                            jamPathDbm[i],
+                            options.fastPathMarginDb,
+                            prediction))
+        {
+            if (options.fastPath == FastPathMode::ON)
+            {
+                results[i] = prediction;
+                ++ctx.stats.fastPathAnalytic;
+                continue;
+            }
+            predicted.push_back(prediction);
+        }
+        else if (options.fastPath == FastPathMode::VALIDATE)
+        {
+            predicted.push_back(SimulationResult{});
+        }
+        pending.push_back(i);
+    }
+
+    if (ctx.profile && options.fastPath != FastPathMode::OFF)
+    {
+        ctx.profile->AddPhase("fastPath", fastPathBegin);
+    }
+
+    std::vector<const char*> profileSource(ctx.profile ? configs.size() : 0, "des");
+    // Punkty z dziennika i pamięci podręcznej nie są symulowane w tym przebiegu, więc nie wchodzą
+    // do liczników symulacji (wysłane pakiety, kopie, faza 1) ani do walidacji szybkiej ścieżki.
+    std::vector<bool> restored(configs.size(), false);
+    std::vector<size_t> remaining;
+    for (size_t index : pending)
+    {
+        if (options.journal && options.journal->Lookup(configs[index], results[index]))
+        {
+            restored[index] = true;
+            ++ctx.stats.journalRestored;
+            if (ctx.profile)
+            {
+                profileSource[index] = "journal";
+            }
+            continue;
+        }
+        if (options.cache && options.cache->Lookup(ctx, configs[index], results[index]))
+        {
+            restored[index] = true;
+            if (ctx.profile)
+            {
+                profileSource[index] = "cache";
+            }
+            continue;
+        }
+        remaining.push_back(index);
+    }
+
+    std::vector<std::pair<size_t, size_t>> copies;
+    std::map<ScanSignature, size_t> representatives;
+    if (options.dedup)
+    {
+        PlanDedup(ctx, configs, remaining, results, copies, representatives);
+    }
+
+    std::vector<size_t> seeded;
+    const ProfileSample seedBegin = ctx.profile ? ProfileSample::Now() : ProfileSample();
+    SeedNoJamCache(ctx, configs, options.jobs, remaining, results, seeded);
+    if (ctx.profile && !seeded.empty())
+    {
+        ctx.profile->AddPhase("simulate", seedBegin);
+    }
+    if (options.journal && !seeded.empty() && !options.journal->Append(configs, seeded, results))
+    {
+        std::cerr << "[Resume] Błąd zapisu dziennika skanu" << std::endl;
+        return false;
+    }
+    for (size_t index : seeded)
+    {
+        if (options.cache)
+        {
+            options.cache->Store(ctx, configs[index], results[index]);
+        }
+    }
+
+    // Z dziennikiem punkty liczymy porcjami i po każdej utrwalamy wyniki, więc przerwany skan
+    // traci co najwyżej jedną porcję. Każda porcja to osobne uruchomienie workerów, dlatego
+    // dziennik jest włączany tylko na życzenie (--resume, --checkpointEvery).
+    const size_t chunk = options.journal ? std::max<size_t>(options.checkpointEvery, options.jobs)
+                                         : std::max<size_t>(remaining.size(), 1);
+    for (size_t begin = 0; begin < remaining.size(); begin += chunk)
+    {
+        std::vector<size_t> part(remaining.begin() + begin,
+                                 remaining.begin() + std::min(begin + chunk, remaining.size()));
+        const ProfileSample simulateBegin = ctx.profile ? ProfileSample::Now() : ProfileSample();
+        if (!RunPendingScenarios(ctx, configs, part, options.jobs, results))
+        {
+            return false;
+        }
+        if (ctx.profile)
+        {
+            ctx.profile->AddPhase("simulate", simulateBegin);
+        }
+        if (options.journal && !options.journal->Append(configs, part, results))
+        {
+            std::cerr << "[Resume] Błąd zapisu dziennika skanu" << std::endl;
+            return false;
+        }
+        for (size_t index : part)
+        {
+            if (options.cache)
+            {
+                options.cache->Store(ctx, configs[index], results[index]);
+            }
+        }
+    }
+    for (const auto& [index, source] : copies)
+    {
+        results[index] = CopySimulatedResult(ctx, results[source], configs[index]);
+    }
+    for (const auto& [signature, index] : representatives)
+    {
+        ctx.dedupCache.emplace(signature, results[index]);
+    }
+
+    ctx.stats.fastPathSimulated += remaining.size();
+    for (size_t index : remaining)
+    {
+        if (results[index].deduplicated)
+        {
+            ++ctx.stats.dedupCopied;
+            continue;
+        }
+        ctx.stats.dedupUnique += options.dedup ? 1 : 0;
+        ctx.stats.packetCopies += results[index].packetCopies;
+        ctx.stats.heapAllocations += results[index].heapAllocations;
+        ctx.stats.tagLookups += results[index].tagLookups;
+        ctx.stats.txSent += results[index].noJamSent + results[index].jamSentTx;
+        ++(results[index].noJamReused ? ctx.stats.noJamReused : ctx.stats.noJamSimulated);
+        ctx.stats.jammersActive += results[index].activeJammers;
+        ++ctx.stats.jammerPoints;
+    }
+    ctx.stats.txBudget += remaining.size() * (static_cast<uint64_t>(ctx.parameters.noJamPackets) + ctx.parameters.withJamPackets);
+
+    if (options.fastPath == FastPathMode::VALIDATE)
+    {
+        for (size_t k = 0; k < pending.size(); ++k)
+        {
+            const SimulationResult& des = results[pending[k]];
+            const SimulationResult& fast = predicted[k];
+            if (!fast.analytic || restored[pending[k]])
+            {
+                continue;
+            }
+            // porównujemy skuteczności, bo przy earlyStop DES wysyła mniej pakietów
+            auto sameRate = [](uint32_t rxA, uint32_t sentA, uint32_t rxB, uint32_t sentB) {
+                return static_cast<uint64_t>(rxA) * sentB == static_cast<uint64_t>(rxB) * sentA;
+            };
+            if (!sameRate(fast.noJamRx, fast.noJamSent, des.noJamRx, des.noJamSent) ||
+                !sameRate(fast.jamRxTx, fast.jamSentTx, des.jamRxTx, des.jamSentTx) ||
+                !sameRate(fast.jamRxJam, fast.jamSentJam, des.jamRxJam, des.jamSentJam))
+            {
+                std::cerr << "[FastPath] Niezgodność dla jam=(" << des.jamX << ", " << des.jamY << ", " << des.jamZ
+                          << ") rx=(" << des.rxX << ", " << des.rxY << "): analitycznie noJamRx="
+                          << fast.noJamRx << " jamRxTx=" << fast.jamRxTx << " jamRxJam=" << fast.jamRxJam
+                          << ", DES noJamRx=" << des.noJamRx << " jamRxTx=" << des.jamRxTx
+                          << " jamRxJam=" << des.jamRxJam << std::endl;
+                ++ctx.stats.fastPathMismatches;
+            }
+            else
+            {
+                ++ctx.stats.fastPathMatches;
+            }
+        }
+    }
+
+    if (ctx.profile)
+    {
+        for (size_t i = 0; i < configs.size(); ++i)
+        {
+            const char* source = results[i].analytic       ? "analytic"
+                                 : results[i].deduplicated ? "dedup"
+                                                           : profileSource[i];
+            ctx.profile->AddPoint(results[i], source);
+        }
+    }
+    return true;
+}
+
+bool
+RunPendingScenarios(SimulationContext& ctx,
+                    const std::vector<SimulationConfig>& configs,
+                    const std::vector<size_t>& pending,
+                    uint32_t jobs,
+                    std::vector<SimulationResult>& results)
+{
+    const uint32_t workers = static_cast<uint32_t>(std::min<size_t>(jobs, pending.size()));
+    if (workers <= 1)
+    {
+        for (size_t index : pending)
+        {
+            results[index] = RunScenario(ctx, configs[index], false);
+        }
+        return true;
+    }
+
+    std::cout.flush();
+    std::cerr.flush();
+    if (ctx.csvSink)
+    {
+        ctx.csvSink->Pause();
+    }
+
+    std::vector<FILE*> parts(workers, nullptr);
+    std::vector<pid_t> pids(workers, -1);
+    bool ok = true;
+    for (uint32_t w = 0; w < workers; ++w)
+    {
+        parts[w] = std::tmpfile();
+        if (!parts[w])
+        {
+            std::cerr << "[Jobs] Nie można utworzyć pliku tymczasowego dla workera " << w << std::endl;
+            ok = false;
+            break;
+        }
+        pids[w] = fork();
+        if (pids[w] < 0)
+        {
+            std::cerr << "[Jobs] fork() nie powiódł się dla workera " << w << std::endl;
+            ok = false;
+            break;
+        }
+        if (pids[w] == 0)
+        {
+            for (size_t k = w; k < pending.size(); k += workers)
+            {
+                uint64_t index = pending[k];
+                SimulationResult res = RunScenario(ctx, configs[index], false);
+                if (std::fwrite(&index, sizeof(index), 1, parts[w]) != 1 ||
+                    std::fwrite(&res, sizeof(res), 1, parts[w]) != 1)
+                {
+                    _exit(1);
+                }
+            }
+            _exit(std::fflush(parts[w]) == 0 ? 0 : 1);
+        }
+    }
+    if (ctx.csvSink)
+    {
+        ctx.csvSink->Resume();
+    }
+
+    std::vector<bool> done(configs.size(), true);
+    for (size_t index : pending)
+    {
+        done[index] = false;
+    }
+    for (uint32_t w = 0; w < workers; ++w)
+    {
+        if (pids[w] > 0)
+        {
+            int status = 0;
+            if (waitpid(pids[w], &status, 0) < 0 || !WIFEXITED(status) || WEXITSTATUS(status) != 0)
+            {
+                std::cerr << "[Jobs] Worker " << w << " zakończył się błędem" << std::endl;
+                ok = false;
+            }
+        }
+        if (!parts[w])
+        {
+            continue;
+        }
+        if (ok)
+        {
+            std::rewind(parts[w]);
+            uint64_t index = 0;
+            SimulationResult res;
+            while (std::fread(&index, sizeof(index), 1, parts[w]) == 1 &&
+                   std::fread(&res, sizeof(res), 1, parts[w]) == 1)
+            {
+                if (index < results.size())
+                {
+                    results[index] = res;
+                    done[index] = true;
+                }
+            }
+        }
+        std::fclose(parts[w]);
+    }
+
+    if (ok && std::find(done.begin(), done.end(), false) != done.end())
+    {
+        std::cerr << "[Jobs] Brak wyników części punktów skanowania" << std::endl;
+        ok = false;
+    }
+    return ok;
+}
+
+void
+ReportFastPath(const SimulationContext& ctx, const SweepOptions& options)
+{
+    if (options.fastPath == FastPathMode::ON)
+    {
+        std::cout << "[FastPath] Punkty wyznaczone analitycznie: " << ctx.stats.fastPathAnalytic
+                  << ", symulacją pakietową: " << ctx.stats.fastPathSimulated << std::endl;
+    }
+    else if (options.fastPath == FastPathMode::VALIDATE)
+    {
+        std::cout << "[FastPath] Walidacja: zgodne " << ctx.stats.fastPathMatches << ", niezgodne "
+                  << ctx.stats.fastPathMismatches << ", niepewne (tylko DES) "
+                  << (ctx.stats.fastPathSimulated - ctx.stats.fastPathMatches - ctx.stats.fastPathMismatches) << std::endl;
+    }
+}
+
+void
+ReportJournal(const SimulationContext& ctx)
+{
+    if (ctx.stats.journalRestored > 0)
+    {
+        std::cout << "[Resume] Pominięto " << ctx.stats.journalRestored
+                  << " punktów policzonych przed przerwaniem skanu" << std::endl;
+    }
+}
+
+void
+ReportJammers(const SimulationContext& ctx)
+{
+    if (!ctx.jammers.empty() && ctx.stats.jammerPoints > 0)
+    {
+        std::cout << "[Jammers] Średnio aktywnych " << static_cast<double>(ctx.stats.jammersActive) / ctx.stats.jammerPoints
+                  << " z " << ctx.jammers.size() << " jammerów na symulowany punkt (próg "
+                  << ctx.parameters.jammerCullDbm << " dBm)" << std::endl;
+    }
+}
+
+// FNV-1a
+uint64_t
+HashBytes(const void* data, size_t size, uint64_t seed)
+{
+    uint64_t hash = 0xcbf29ce484222325ULL ^ seed;
+    const auto* bytes = static_cast<const unsigned char*>(data);
+    for (size_t i = 0; i < size; ++i)
+    {
+        hash = (hash ^ bytes[i]) * 0x100000001b3ULL;
+    }
+    return hash;
+}
+
+// Odcisk ustawień symulacji wspólnych dla wszystkich punktów: moc TX, czułość, odstępy, liczby
+// pakietów, earlyStop, jammery z --jammerFile i układ SimulationResult. Wzmocnienie jammera jest
+// częścią konfiguracji punktu (klucze dziennika i pamięci wyników).
+uint64_t
+ScenarioFingerprint(const SimulationContext& ctx)
+{
+    const double values[] = {ctx.parameters.txPowerDbm,
+                             ctx.parameters.rxSensitivityDbm,
+                             kPktGapSeconds,
+                             kGapBetweenPhases,
+                             static_cast<double>(ctx.parameters.noJamPackets),
+                             static_cast<double>(ctx.parameters.withJamPackets),
+                             static_cast<double>(kChannelNumber),
+                             static_cast<double>(kPayloadBytes),
+                             ctx.parameters.earlyStop.enabled ? 1.0 : 0.0,
+                             ctx.parameters.earlyStop.enabled ? ctx.parameters.earlyStop.confidence : 0.0,
+                             ctx.parameters.earlyStop.enabled ? static_cast<double>(ctx.parameters.earlyStop.batch) : 0.0,
+                             ctx.parameters.earlyStop.enabled ? ctx.parameters.earlyStop.threshold : 0.0,
+                             ctx.parameters.earlyStop.enabled ? ctx.parameters.earlyStop.noJamHalfWidth : 0.0,
+                             ctx.parameters.jammerCullDbm,
+                             ctx.parameters.shadowingSigmaDb,
+                             ctx.parameters.bodyShadowingSigmaDb,
+                             static_cast<double>(ctx.parameters.IsStochastic() ? RngSeedManager::GetSeed() : 0),
+                             static_cast<double>(ctx.parameters.IsStochastic() ? ctx.parameters.baseRun : 0),
+                             static_cast<double>(sizeof(SimulationResult))};
+    uint64_t fingerprint = HashBytes(values, sizeof(values), 0);
+    for (const Vector& position : ctx.parameters.jammerPositions)
+    {
+        const double coordinates[] = {position.x, position.y, position.z};
+        fingerprint = HashBytes(coordinates, sizeof(coordinates), fingerprint);
+    }
+    return fingerprint;
+}
+
+// Odcisk ustawień, od których zależą wyniki pojedynczego punktu (pozycje i organ są w kluczu
+// rekordu). Dziennik z innymi ustawieniami nie może zostać wznowiony.
+uint64_t
+JournalFingerprint(const SimulationContext& ctx, const SweepOptions& options)
+{
+    const double values[] = {static_cast<double>(options.fastPath), options.fastPathMarginDb};
+    uint64_t fingerprint = HashBytes(values, sizeof(values), ScenarioFingerprint(ctx));
+    // organy z --tissueFile: ta sama opcja może oznaczać inne wartości po zmianie pliku
+    for (uint32_t option = BodyPropagationLossModel::BUILTIN_BODY_OPTIONS;
+         option < BodyPropagationLossModel::GetBodyOptionCount();
+         ++option)
+    {
+        const BodyDielectricParameters& row =
+            BodyPropagationLossModel::GetDielectricParameters(static_cast<BodyOrganOption>(option));
+        fingerprint = HashBytes(&row, sizeof(row), fingerprint);
+    }
+    return fingerprint;
+}
+
+void
+ReportPacketStats(const SimulationContext& ctx)
+{
+    std::cout << "[Packets] Skan: " << ctx.stats.packetCopies
+              << " wysyłek jako kopie szablonów (Packet::Copy bez nowego bufora i tagu), "
+              << ctx.stats.heapAllocations << " alokacji sterty w Simulator::Run() ("
+              << (ctx.stats.packetCopies ? static_cast<double>(ctx.stats.heapAllocations) / ctx.stats.packetCopies : 0.0)
+              << " na wysyłkę), " << ctx.stats.tagLookups << " odczytów tagu przy odbiorze" << std::endl;
+    if (ctx.stats.dedupUnique + ctx.stats.dedupCopied > 0)
+    {
+        std::cout << "[Dedup] Symulowane sygnatury odległości: " << ctx.stats.dedupUnique << ", wiersze skopiowane: "
+                  << ctx.stats.dedupCopied << std::endl;
+    }
+    if (ctx.parameters.reuseNoJamPhase)
+    {
+        std::cout << "[NoJamCache] Faza 1 symulowana " << ctx.stats.noJamSimulated << " razy, ponownie użyta "
+                  << ctx.stats.noJamReused << " razy" << std::endl;
+    }
+    if (ctx.parameters.earlyStop.enabled && ctx.stats.txBudget > 0)
+    {
+        std::cout << "[EarlyStop] Punkty symulowane wysłały " << ctx.stats.txSent << " z " << ctx.stats.txBudget
+                  << " pakietów TX (" << 100.0 * ctx.stats.txSent / ctx.stats.txBudget << "%)" << std::endl;
+    }
+}
+
+bool
+IsJammed(const SimulationResult& res, double jamThreshold)
+{
+    double jamRate = res.jamSentTx ? static_cast<double>(res.jamRxTx) / res.jamSentTx : 0.0;
+    return jamRate <= jamThreshold;
+}
+
+// Kwantyl rozkładu normalnego (bisekcja na erfc; wołane raz na punkt skanu).
+double
+NormalQuantile(double p)
+{
+    double lo = -40.0;
+    double hi = 40.0;
+    for (int i = 0; i < 200 && hi - lo > 1e-12; ++i)
+    {
+        double mid = 0.5 * (lo + hi);
+        if (0.5 * std::erfc(-mid / M_SQRT2) < p)
+        {
+            lo = mid;
+        }
+        else
+        {
+            hi = mid;
+        }
+    }
+    return 0.5 * (lo + hi);
+}
+
+// Faza sprawdzana co `batch` pakietów ma (packets - 1) / batch sprawdzeń. Dopuszczalny błąd
+// 1 - confidence dzielimy równo między nie (Bonferroni), więc decyzja całej fazy ma ufność
+// co najmniej `confidence` mimo wielokrotnego sprawdzania. Każde sprawdzenie jest jednostronne:
+// przy danej prawdziwej skuteczności błędna może być tylko jedna z dwóch decyzji.
+double
+EarlyStopZ(const EarlyStopOptions& earlyStop, uint32_t packets)
+{
+    uint32_t looks = packets > 1 ? std::max(1u, (packets - 1) / earlyStop.batch) : 1;
+    return NormalQuantile(1.0 - (1.0 - earlyStop.confidence) / looks);
+}
+
+void
+WilsonInterval(uint32_t successes, uint32_t trials, double z, double& low, double& high)
+{
+    if (trials == 0)
+    {
+        low = 0.0;
+        high = 1.0;
+        return;
+    }
+    const double n = trials;
+    const double p = successes / n;
+    const double z2 = z * z;
+    const double center = (p + z2 / (2 * n)) / (1 + z2 / n);
+    const double half = z / (1 + z2 / n) * std::sqrt(p * (1 - p) / n + z2 / (4 * n * n));
+    low = std::max(0.0, center - half);
+    high = std::min(1.0, center + half);
+}
+
+// Faza rozstrzygnięta: cały przedział po jednej stronie progu, zgodnie z IsJammed (rate <= próg).
+bool
+IsRateDecided(const EarlyStopOptions& earlyStop, uint32_t successes, uint32_t trials, double z)
+{
+    double low = 0.0;
+    double high = 1.0;
+    WilsonInterval(successes, trials, z, low, high);
+    return high <= earlyStop.threshold || low > earlyStop.threshold;
+}
+
+// Faza 1: przedział węższy niż 2 * noJamHalfWidth. Przy skuteczności bliskiej 0 albo 1 (typowe
+// łącza) następuje to po kilkuset pakietach, przy pośrednich faza zwykle idzie do końca.
+bool
+IsRatePrecise(const EarlyStopOptions& earlyStop, uint32_t successes, uint32_t trials, double z)
+{
+    double low = 0.0;
+    double high = 1.0;
+    WilsonInterval(successes, trials, z, low, high);
+    return high - low <= 2.0 * earlyStop.noJamHalfWidth;
+}
+
+double
+ScanDistance(const SimulationResult& res, bool scanJam)
+{
+    return scanJam ? std::hypot(res.rxX - res.jamX, res.rxY - res.jamY)
+                   : std::hypot(res.rxX - res.txX, res.rxY - res.txY);
+}
+
+std::string
+ScanCsvHeader(const SimulationContext& ctx, const SweepOptions& options)
+{
+    std::string header = options.organColumn ? "organ," : "";
+    header += "rxX,rxY,txRxDistance,rxJamDistance,scanCoordinate,bodyLossDb,bodyRxPowerDbm,jamRxPowerDbm,jamLossDb,noJamSuccessRate,jamSuccessRate,isJammed,noJamPacketsRx,jamPacketsRx,jamPacketsFromJammerRx";
+    if (options.fastPath != FastPathMode::OFF)
+    {
+        header += ",resultPath";
+    }
+    if (ctx.parameters.earlyStop.enabled)
+    {
+        header += ",noJamPacketsSent,noJamCiLow,noJamCiHigh,jamPacketsSent,jamCiLow,jamCiHigh";
+    }
+    if (ctx.parameters.replications > 1)
+    {
+        header += ",replications,noJamRateMean,noJamRateCiLow,noJamRateCiHigh,jamRateMean,jamRateCiLow,jamRateCiHigh";
+    }
+    return header;
+}
+
+std::string
+GridCsvHeader(const SimulationContext& ctx, const SweepOptions& options)
+{
+    std::string header = options.organColumn ? "organ," : "";
+    header += "jamX,jamY,jamZ,cellSize,rxJamDistance,jamRxPowerDbm,noJamSuccessRate,jamSuccessRate,isJammed";
+    if (options.fastPath != FastPathMode::OFF)
+    {
+        header += ",resultPath";
+    }
+    if (ctx.parameters.earlyStop.enabled)
+    {
+        header += ",noJamPacketsSent,noJamCiLow,noJamCiHigh,jamPacketsSent,jamCiLow,jamCiHigh";
+    }
+    return header;
+}
+
+void
+AppendEarlyStopColumns(const SimulationContext& ctx, CsvRow& row, const SimulationResult& res)
+{
+    if (ctx.parameters.earlyStop.enabled)
+    {
+        row << res.noJamSent << res.noJamCiLow << res.noJamCiHigh << res.jamSentTx << res.jamCiLow
+            << res.jamCiHigh;
+    }
+}
+
+void
+WriteScanCsvRow(const SimulationContext& ctx,
+                CsvSink& csv,
+                const SimulationResult& res,
+                double scanCoordinate,
+                double jamThreshold,
+                const SweepOptions& options)
+{
+    double noJamRate = res.noJamSent ? static_cast<double>(res.noJamRx) / res.noJamSent : 0.0;
+    double jamRate = res.jamSentTx ? static_cast<double>(res.jamRxTx) / res.jamSentTx : 0.0;
+    bool jammed = jamRate <= jamThreshold;
+    double txRxDistance = std::hypot(res.rxX - res.txX, res.rxY - res.txY);
+    double jamRxDistance = std::hypot(res.rxX - res.jamX, res.rxY - res.jamY);
+
+    CsvRow row;
+    if (options.organColumn)
+    {
+        row << BodyOrganOptionToString(res.organOption);
+    }
+    row << res.rxX << res.rxY << txRxDistance << jamRxDistance << scanCoordinate << res.bodyLossDb
+        << res.bodyRxPowerDbm << res.jamRxPowerDbm << res.jamLossDb << noJamRate << jamRate
+        << (jammed ? 1 : 0) << res.noJamRx << res.jamRxTx << res.jamRxJam;
+    if (options.fastPath != FastPathMode::OFF)
+    {
+        row << (res.analytic ? "analytic" : "des");
+    }
+    AppendEarlyStopColumns(ctx, row, res);
+    if (ctx.parameters.replications > 1)
+    {
+        row << res.replications << res.noJamRateMean << res.noJamRateMean - res.noJamRateCiHalf
+            << res.noJamRateMean + res.noJamRateCiHalf << res.jamRateMean << res.jamRateMean - res.jamRateCiHalf
+            << res.jamRateMean + res.jamRateCiHalf;
+    }
+    csv.Push(row);
+}
+
+// Jeden wiersz z `count` replikacji punktu: liczniki pakietów są sumowane (skuteczności w kolumnach
+// podstawowych i isJammed są więc liczone z puli pakietów), pozycje i moce pochodzą z replikacji 0,
+// a średnie skuteczności mają 95% przedział ufności ze średniej i odchylenia z próby
+// (przybliżenie normalne).
 SimulationResult
-RunScenario(SimulationContext& ctx, const SimulationConfig& config, bool enableLogs)
+SummarizeReplications(const SimulationResult* replicas, uint32_t count)
 {
-    ResetCounters();
-    ctx.bodyLoss->SetBodyOptions(config.organOption);
-    ctx.mTx->SetPosition(Vector(config.txX, config.txY, 0));
-    ctx.mRx->SetPosition(Vector(config.rxX, config.rxY, 0));
-    ctx.mJam->SetPosition(Vector(config.jamX, config.jamY, 0));
+    SimulationResult summary = replicas[0];
+    summary.noJamSent = summary.noJamRx = summary.jamSentTx = summary.jamRxTx = 0;
+    summary.jamSentJam = summary.jamRxJam = 0;
+    summary.replications = count;
+    std::vector<double> noJamRates(count);
+    std::vector<double> jamRates(count);
+    for (uint32_t r = 0; r < count; ++r)
+    {
+        const SimulationResult& res = replicas[r];
+        summary.noJamSent += res.noJamSent;
+        summary.noJamRx += res.noJamRx;
+        summary.jamSentTx += res.jamSentTx;
+        summary.jamRxTx += res.jamRxTx;
+        summary.jamSentJam += res.jamSentJam;
+        summary.jamRxJam += res.jamRxJam;
+        noJamRates[r] = res.noJamSent ? static_cast<double>(res.noJamRx) / res.noJamSent : 0.0;
+        jamRates[r] = res.jamSentTx ? static_cast<double>(res.jamRxTx) / res.jamSentTx : 0.0;
+    }
+    const double z = NormalQuantile(0.975);
+    auto meanAndHalfWidth = [count, z](const std::vector<double>& rates, double& mean, double& halfWidth) {
+        mean = 0.0;
+        for (double rate : rates)
+        {
+            mean += rate;
+        }
+        mean /= count;
+        double variance = 0.0;
+        for (double rate : rates)
+        {
+            variance += (rate - mean) * (rate - mean);
+        }
+        halfWidth = count > 1 ? z * std::sqrt(variance / (count - 1) / count) : 0.0;
+    };
+    meanAndHalfWidth(noJamRates, summary.noJamRateMean, summary.noJamRateCiHalf);
+    meanAndHalfWidth(jamRates, summary.jamRateMean, summary.jamRateCiHalf);
+    return summary;
+}
+
+// Szuka pierwszego punktu siatki skanu bez jammingu przy założeniu, że isJammed zmienia się
+// wzdłuż siatki co najwyżej raz (kanał jest deterministyczny i monotoniczny z odległością).
+// W każdej rundzie liczymy `options.jobs` punktów wewnątrz przedziału (przy jobs=1 to zwykła bisekcja),
+// więc zamiast N symulacji potrzeba ich ~log2(N). Wynik jest taki sam jak w skanie liniowym.
+bool
+FindFirstSafeIndex(SimulationContext& ctx,
+                   const std::vector<SimulationConfig>& configs,
+                   const SweepOptions& options,
+                   double jamThreshold,
+                   std::map<size_t, SimulationResult>& evaluated,
+                   size_t& firstSafe)
+{
+    auto evaluate = [&](const std::vector<size_t>& indices) {
+        std::vector<SimulationConfig> batch;
+        for (size_t index : indices)
+        {
+            batch.push_back(configs[index]);
+        }
+        std::vector<SimulationResult> results;
+        if (!RunScenarioBatch(ctx, batch, options, results))
+        {
+            return false;
+        }
+        for (size_t i = 0; i < indices.size(); ++i)
+        {
+            evaluated[indices[i]] = results[i];
+        }
+        return true;
+    };
+
+    firstSafe = configs.size();
+    if (configs.empty())
+    {
+        return true;
+    }
+
+    size_t lo = 0;
+    size_t hi = configs.size() - 1;
+    if (!evaluate(lo == hi ? std::vector<size_t>{lo} : std::vector<size_t>{lo, hi}))
+    {
+        return false;
+    }
+    if (!IsJammed(evaluated[lo], jamThreshold))
+    {
+        firstSafe = lo;
+        return true;
+    }
+    if (IsJammed(evaluated[hi], jamThreshold))
+    {
+        return true;
+    }
+
+    // Niezmiennik: lo jest zagłuszony, hi nie.
+    while (hi - lo > 1)
+    {
+        size_t interior = std::min<size_t>(std::max(1u, options.jobs), hi - lo - 1);
+        std::vector<size_t> probes;
+        for (size_t k = 1; k <= interior; ++k)
+        {
+            probes.push_back(lo + (hi - lo) * k / (interior + 1));
+        }
+        if (!evaluate(probes))
+        {
+            return false;
+        }
+        for (size_t index : probes)
+        {
+            if (IsJammed(evaluated[index], jamThreshold))
+            {
+                lo = index;
+            }
+            else
+            {
+                hi = index;
+                break;
+            }
+        }
+    }
+
+    firstSafe = hi;
+    return true;
+}
+
+std::string
+PowerCsvHeader(const SweepOptions& options)
+{
+    std::string header = options.organColumn ? "organ," : "";
+    header += "scanCoordinate,txRxDistance,rxJamDistance,minJamBoostDb,jamTxPowerDbm,jamRxPowerDbm,"
+              "noJamSuccessRate,jamSuccessRate,status,simulations";
+    return header;
+}
+
+// Tryb --scanMode=power: granica mocy jammera w funkcji odległości. Dla każdej pozycji skanu
+// szukamy najmniejszego wzmocnienia z siatki [minDb, maxDb] co stepDb, przy którym łącze jest
+// zagłuszone. Skuteczność TX maleje monotonicznie z mocą jammera, więc po ustawieniu siatki
+// malejąco (od maxDb) jest to FindFirstSafeIndex: pierwszy niezagłuszony punkt leży tuż pod
+// szukanym wzmocnieniem. status: "found", "belowMin" (zagłuszone już przy minDb) albo
+// "aboveMax" (niezagłuszone nawet przy maxDb, minJamBoostDb = nan).
+bool
+RunPowerSolver(SimulationContext& ctx,
+               const std::vector<SimulationConfig>& configs,
+               const std::vector<double>& scanPositions,
+               bool scanJam,
+               const PowerSolverOptions& solver,
+               const SweepOptions& options,
+               double jamThreshold,
+               CsvSink& csv)
+{
+    std::vector<double> boosts = BuildScanPositions(solver.minDb, solver.maxDb, solver.stepDb);
+    std::reverse(boosts.begin(), boosts.end());
+    size_t simulations = 0;
+    for (size_t p = 0; p < configs.size(); ++p)
+    {
+        std::vector<SimulationConfig> boostConfigs(boosts.size(), configs[p]);
+        for (size_t k = 0; k < boosts.size(); ++k)
+        {
+            boostConfigs[k].jamBoostDb = boosts[k];
+        }
+        std::map<size_t, SimulationResult> evaluated;
+        size_t firstSafe = 0;
+        if (!FindFirstSafeIndex(ctx, boostConfigs, options, jamThreshold, evaluated, firstSafe))
+        {
+            return false;
+        }
+        simulations += evaluated.size();
+
+        const char* status = firstSafe == 0 ? "aboveMax" : firstSafe == boosts.size() ? "belowMin" : "found";
+        const SimulationResult& res = evaluated[firstSafe == 0 ? 0 : firstSafe - 1];
+        const double minBoost = firstSafe == 0 ? std::numeric_limits<double>::quiet_NaN() : res.jamBoostDb;
+        const double noJamRate = res.noJamSent ? static_cast<double>(res.noJamRx) / res.noJamSent : 0.0;
+        const double jamRate = res.jamSentTx ? static_cast<double>(res.jamRxTx) / res.jamSentTx : 0.0;
+
+        CsvRow row;
+        if (options.organColumn)
+        {
+            row << BodyOrganOptionToString(res.organOption);
+        }
+        row << scanPositions[p] << std::hypot(res.rxX - res.txX, res.rxY - res.txY)
+            << std::hypot(res.rxX - res.jamX, res.rxY - res.jamY) << minBoost
+            << ctx.parameters.txPowerDbm + minBoost << res.jamRxPowerDbm << noJamRate << jamRate << status
+            << static_cast<uint32_t>(evaluated.size());
+        csv.Push(row);
+
+        std::cout << "[Power] " << (scanJam ? "jam" : "rx") << "=" << scanPositions[p]
+                  << " m: minJamBoostDb=" << minBoost << " (" << status << ", " << evaluated.size()
+                  << " symulacji)" << std::endl;
+    }
+    std::cout << "[Power] Wykonano " << simulations << " symulacji zamiast "
+              << configs.size() * boosts.size() << std::endl;
+    return true;
+}
+
+// Skan siatkowy pozycji jammera z podziałem typu quadtree (2D) lub octree (gdy zakres Z jest
+// niezerowy). Zaczynamy od komórek o boku step * 2^levels i dzielimy tylko te, których narożniki
+// różnią się klasyfikacją isJammed, więc gęste próbkowanie dostaje wyłącznie okolica granicy
+// jammingu. Narożniki są wspólne dla sąsiednich komórek i liczone raz (klucz w siatce step).
+bool
+RunGridScan(SimulationContext& ctx,
+            const SimulationConfig& baseConfig,
+            const GridScanOptions& grid,
+            const SweepOptions& options,
+            double jamThreshold,
+            CsvSink& csv)
+{
+    struct GridCell
+    {
+        uint32_t x;
+        uint32_t y;
+        uint32_t z;
+        uint32_t size;
+    };
+    struct GridPoint
+    {
+        SimulationResult result;
+        uint32_t cellSize;
+    };
+
+    auto latticeSize = [&grid](double start, double stop) {
+        return static_cast<uint32_t>(std::max(0.0, std::ceil((stop - start) / grid.step - 1e-9)));
+    };
+    const uint32_t nx = latticeSize(grid.xStart, grid.xStop);
+    const uint32_t ny = latticeSize(grid.yStart, grid.yStop);
+    const uint32_t nz = latticeSize(grid.zStart, grid.zStop);
+    const uint32_t coarse = 1u << grid.levels;
+    const bool octree = nz > 0;
+    const uint32_t kMaxLattice = (1u << 21) - 1;
+    if (nx > kMaxLattice || ny > kMaxLattice || nz > kMaxLattice)
+    {
+        std::cerr << "[Grid] Zbyt gęsta siatka (maks. " << kMaxLattice << " kroków na oś)" << std::endl;
+        return false;
+    }
+
+    auto pointKey = [](uint32_t ix, uint32_t iy, uint32_t iz) {
+        return (static_cast<uint64_t>(iz) << 42) | (static_cast<uint64_t>(iy) << 21) | ix;
+    };
+    auto cellCorners = [&](const GridCell& cell) {
+        std::vector<uint64_t> corners;
+        for (uint32_t dz = 0; dz <= (octree ? 1u : 0u); ++dz)
+        {
+            for (uint32_t dy = 0; dy <= 1; ++dy)
+            {
+                for (uint32_t dx = 0; dx <= 1; ++dx)
+                {
+                    corners.push_back(pointKey(std::min(cell.x + dx * cell.size, nx),
+                                               std::min(cell.y + dy * cell.size, ny),
+                                               std::min(cell.z + dz * cell.size, nz)));
+                }
+            }
+        }
+        return corners;
+    };
+
+    std::vector<GridCell> cells;
+    for (uint32_t z = 0; z == 0 || z < nz; z += coarse)
+    {
+        for (uint32_t y = 0; y == 0 || y < ny; y += coarse)
+        {
+            for (uint32_t x = 0; x == 0 || x < nx; x += coarse)
+            {
+                cells.push_back(GridCell{x, y, z, coarse});
+            }
+        }
+    }
+
+    std::map<uint64_t, GridPoint> points;
+    while (!cells.empty())
+    {
+        std::vector<uint64_t> pending;
+        for (const GridCell& cell : cells)
+        {
+            for (uint64_t key : cellCorners(cell))
+            {
+                auto it = points.find(key);
+                if (it == points.end())
+                {
+                    points.emplace(key, GridPoint{SimulationResult{}, cell.size});
+                    pending.push_back(key);
+                }
+                else
+                {
+                    it->second.cellSize = std::min(it->second.cellSize, cell.size);
+                }
+            }
+        }
+
+        std::vector<SimulationConfig> batch;
+        for (uint64_t key : pending)
+        {
+            SimulationConfig config = baseConfig;
+            config.jamX = grid.xStart + static_cast<double>(key & kMaxLattice) * grid.step;
+            config.jamY = grid.yStart + static_cast<double>((key >> 21) & kMaxLattice) * grid.step;
+            config.jamZ = grid.zStart + static_cast<double>(key >> 42) * grid.step;
+            batch.push_back(config);
+        }
+        std::vector<SimulationResult> results;
+        if (!RunScenarioBatch(ctx, batch, options, results))
+        {
+            return false;
+        }
+        for (size_t i = 0; i < pending.size(); ++i)
+        {
+            points[pending[i]].result = results[i];
+        }
+
+        std::vector<GridCell> refined;
+        for (const GridCell& cell : cells)
+        {
+            if (cell.size == 1)
+            {
+                continue;
+            }
+            std::vector<uint64_t> corners = cellCorners(cell);
+            bool firstJammed = IsJammed(points[corners.front()].result, jamThreshold);
+            bool disagree = std::any_of(corners.begin(), corners.end(), [&](uint64_t key) {
+                return IsJammed(points[key].result, jamThreshold) != firstJammed;
+            });
+            if (!disagree)
+            {
+                continue;
+            }
+            const uint32_t half = cell.size / 2;
+            for (uint32_t dz = 0; dz <= (octree ? 1u : 0u); ++dz)
+            {
+                for (uint32_t dy = 0; dy <= 1; ++dy)
+                {
+                    for (uint32_t dx = 0; dx <= 1; ++dx)
+                    {
+                        GridCell child{cell.x + dx * half, cell.y + dy * half, cell.z + dz * half, half};
+                        if ((child.x < nx || dx == 0) && (child.y < ny || dy == 0) &&
+                            (child.z < nz || dz == 0))
+                        {
+                            refined.push_back(child);
+                        }
+                    }
+                }
+            }
+        }
+        cells.swap(refined);
+    }
+
+    for (const auto& [key, point] : points)
+    {
+        const SimulationResult& res = point.result;
+        double noJamRate = res.noJamSent ? static_cast<double>(res.noJamRx) / res.noJamSent : 0.0;
+        double jamRate = res.jamSentTx ? static_cast<double>(res.jamRxTx) / res.jamSentTx : 0.0;
+        double jamRxDistance = std::sqrt((res.rxX - res.jamX) * (res.rxX - res.jamX) +
+                                         (res.rxY - res.jamY) * (res.rxY - res.jamY) +
+                                         res.jamZ * res.jamZ);
+        CsvRow row;
+        if (options.organColumn)
+        {
+            row << BodyOrganOptionToString(res.organOption);
+        }
+        row << res.jamX << res.jamY << res.jamZ << point.cellSize * grid.step << jamRxDistance
+            << res.jamRxPowerDbm << noJamRate << jamRate << (IsJammed(res, jamThreshold) ? 1 : 0);
+        if (options.fastPath != FastPathMode::OFF)
+        {
+            row << (res.analytic ? "analytic" : "des");
+        }
+        AppendEarlyStopColumns(ctx, row, res);
+        csv.Push(row);
+    }
+
+    uint64_t fullGrid = static_cast<uint64_t>(nx + 1) * (ny + 1) * (nz + 1);
+    std::cout << "[Grid] Policzono " << points.size() << " punktów zamiast " << fullGrid
+              << " dla pełnej siatki" << std::endl;
+    return true;
+}
+
+// Plik --trajectoryFile: jeden waypoint na linię, "t x y [z]" (s, m), czasy rosnące od t >= 0;
+// '#' zaczyna komentarz. Na przykład zapis ruchu osoby z jammerem po pomieszczeniu.
+bool
+LoadTrajectory(const std::string& path, std::vector<std::pair<double, Vector>>& waypoints)
+{
+    std::ifstream in(path);
+    if (!in)
+    {
+        std::cerr << "[Trajectory] Nie można otworzyć pliku '" << path << "'" << std::endl;
+        return false;
+    }
+    waypoints.clear();
+    std::string line;
+    for (uint32_t lineNumber = 1; std::getline(in, line); ++lineNumber)
+    {
+        line = line.substr(0, line.find('#'));
+        std::istringstream fields(line);
+        std::vector<double> values;
+        double value;
+        while (fields >> value)
+        {
+            values.push_back(value);
+        }
+        if (values.empty() && fields.eof())
+        {
+            continue;
+        }
+        if (!fields.eof() || values.size() < 3 || values.size() > 4 || values[0] < 0.0 ||
+            (!waypoints.empty() && values[0] <= waypoints.back().first))
+        {
+            std::cerr << "[Trajectory] " << path << ":" << lineNumber
+                      << ": oczekiwano \"t x y [z]\" z czasem większym niż w poprzedniej linii" << std::endl;
+            return false;
+        }
+        waypoints.emplace_back(values[0], Vector(values[1], values[2], values.size() == 4 ? values[3] : 0.0));
+    }
+    if (waypoints.size() < 2)
+    {
+        std::cerr << "[Trajectory] " << path << ": potrzebne są co najmniej dwa waypointy" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+// Ruch jednostajny wzdłuż X przez pozycje skanu: okno k obejmuje odcinek scanStep wokół
+// scanStart + k * scanStep, a średnia pozycja pakietów okna wypada dokładnie w tym punkcie.
+void
+BuildLinearTrajectory(const SimulationConfig& baseConfig,
+                      double scanStart,
+                      double scanStop,
+                      double scanStep,
+                      TrajectoryOptions& trajectory)
+{
+    const size_t bins = BuildScanPositions(scanStart, scanStop, scanStep).size();
+    const uint32_t binPackets = trajectory.binPackets;
+    const double stepPerPacket = scanStep / binPackets;
+    const double x0 = scanStart - 0.5 * scanStep + 0.5 * stepPerPacket;
+    const double lastPacket = static_cast<double>(bins * binPackets - 1);
+    const double y = trajectory.moveJam ? baseConfig.jamY : baseConfig.rxY;
+    const double z = trajectory.moveJam ? baseConfig.jamZ : 0.0;
+    trajectory.waypoints = {{0.0, Vector(x0, y, z)},
+                            {lastPacket * kPktGapSeconds, Vector(x0 + lastPacket * stepPerPacket, y, z)}};
+}
+
+// Jeden przebieg z ruchomym węzłem: TX (i przy withJammer jammery) nadaje co kPktGapSeconds przez
+// cały czas trajektorii, a odbiory są przypisywane do okna ostatniej wysyłki TX (odstęp między
+// pakietami jest dłuższy niż czas nadawania, jak przy earlyStop). Bez przygotowania punktów,
+// powtórek fazy 1 i restartów symulatora.
+std::vector<TrajectoryBin>
+RunTrajectory(SimulationContext& ctx,
+              const SimulationConfig& config,
+              const TrajectoryOptions& trajectory,
+              bool withJammer)
+{
+    SimulationResult prepared;
+    PrepareScenario(ctx, config, prepared);
+    if (!trajectory.moveJam)
+    {
+        // odcięcie jammerów z --jammerFile dotyczy jednej pozycji RX, a RX się rusza
+        ctx.activeJammers.clear();
+        for (uint32_t index = 0; index < ctx.jammers.size(); ++index)
+        {
+            ctx.activeJammers.push_back(index);
+        }
+    }
+    ctx.counters = ScenarioCounters();
+
+    const Time pktGap = Seconds(kPktGapSeconds);
+    const Time start = Simulator::Now() + Seconds(0.5);
+    const uint32_t packets =
+        static_cast<uint32_t>(std::floor(trajectory.waypoints.back().first / kPktGapSeconds + 1e-9)) + 1;
+    const uint32_t binPackets = trajectory.binPackets;
+    std::vector<TrajectoryBin> bins((packets + binPackets - 1) / binPackets);
+
+    Ptr<WaypointMobilityModel> moving = CreateObject<WaypointMobilityModel>();
+    moving->AddWaypoint(Waypoint(Simulator::Now(), trajectory.waypoints.front().second));
+    for (const auto& [t, position] : trajectory.waypoints)
+    {
+        moving->AddWaypoint(Waypoint(start + Seconds(t), position));
+    }
+    auto phy = trajectory.moveJam ? ctx.jamDev->GetPhy() : ctx.rxDev->GetPhy();
+    phy->SetMobility(moving);
+
+    Simulator::Schedule(Seconds(0.2), [&ctx, withJammer]() {
+        ctx.txDev->GetPhy()->PhySetTRXStateRequest(WbanPhyState::PHY_TX_ON);
+        ctx.rxDev->GetPhy()->PhySetTRXStateRequest(WbanPhyState::PHY_RX_ON);
+        if (withJammer)
+        {
+            ctx.jamDev->GetPhy()->PhySetTRXStateRequest(WbanPhyState::PHY_TX_ON);
+            for (uint32_t index : ctx.activeJammers)
+            {
+                ctx.jammers[index].dev->GetPhy()->PhySetTRXStateRequest(WbanPhyState::PHY_TX_ON);
+            }
+        }
+        ctx.counters.jammingActive = withJammer;
+    });
+
+    uint32_t rxMark = 0;
+    uint32_t jamRxMark = 0;
+    auto closeBin = [&](size_t k) {
+        const uint32_t rx = withJammer ? ctx.counters.jamRxTx : ctx.counters.noJamRx;
+        bins[k].rx = rx - rxMark;
+        bins[k].jamRx = ctx.counters.jamRxJam - jamRxMark;
+        rxMark = rx;
+        jamRxMark = ctx.counters.jamRxJam;
+    };
+
+    TrafficSource jamSource;
+    TrafficSource txSource;
+    if (withJammer)
+    {
+        // jak w fazie 2 RunScenario: jammery startują przed TX
+        jamSource.Start(Seconds(0.5), pktGap, packets, [&](uint32_t) {
+            ctx.jamDev->GetPhy()->PhyDataRequest(ctx.jamTemplate->GetSize(), ctx.jamTemplate->Copy());
+            ++ctx.counters.packetCopies;
+            ++ctx.counters.jamSentJam;
+            for (uint32_t index : ctx.activeJammers)
+            {
+                ctx.jammers[index].dev->GetPhy()->PhyDataRequest(ctx.jamTemplate->GetSize(),
+                                                                 ctx.jamTemplate->Copy());
+                ++ctx.counters.packetCopies;
+                ++ctx.counters.jamSentJam;
+            }
+        });
+    }
+    txSource.Start(Seconds(0.5), pktGap, packets, [&](uint32_t i) {
+        if (i > 0 && i % binPackets == 0)
+        {
+            closeBin(i / binPackets - 1);
+        }
+        TrajectoryBin& bin = bins[i / binPackets];
+        if (bin.sent == 0)
+        {
+            bin.tStart = i * kPktGapSeconds;
+        }
+        const Vector position = moving->GetPosition();
+        bin.sum.x += position.x;
+        bin.sum.y += position.y;
+        bin.sum.z += position.z;
+        ++bin.sent;
+        ctx.txDev->GetPhy()->PhyDataRequest(kPayloadBytes, ctx.txTemplate->Copy());
+        ++ctx.counters.packetCopies;
+        ++(withJammer ? ctx.counters.jamSentTx : ctx.counters.noJamSent);
+    });
+
+    EventId stopEvent = Simulator::Stop(Seconds(0.5 + packets * kPktGapSeconds + 1.0));
+    const uint64_t allocationsBegin = t_heapAllocations;
+    Simulator::Run();
+    ctx.stats.heapAllocations += t_heapAllocations - allocationsBegin;
+    stopEvent.Cancel();
+    closeBin(bins.size() - 1);
 
-    double bodyRxPowerDbm = ctx.bodyLoss->CalcRxPower(kTxPowerDbm, ctx.mTx, ctx.mRx);
-    double bodyLossDb = kTxPowerDbm - bodyRxPowerDbm;
-    double jamRxPowerDbm = ctx.pathLoss->CalcRxPower(kTxPowerDbm + kJamBoostDb, ctx.mJam, ctx.mRx);
-    double jamLossDb = (kTxPowerDbm + kJamBoostDb) - jamRxPowerDbm;
-    BodyDielectricParameters params = ctx.bodyLoss->m_parameters;
+    phy->SetMobility(trajectory.moveJam ? ctx.mJam : ctx.mRx);
+    ctx.stats.packetCopies += ctx.counters.packetCopies;
+    ctx.stats.tagLookups += ctx.counters.tagLookups;
+    return bins;
+}
+
+std::string
+TrajectoryCsvHeader(const SweepOptions& options)
+{
+    std::string header = options.organColumn ? "organ," : "";
+    header += "bin,tStart,tStop,movingX,movingY,movingZ,txRxDistance,rxJamDistance,noJamSuccessRate,jamSuccessRate,isJammed,packetsSent,noJamPacketsSent,noJamPacketsRx,jamPacketsRx,jamPacketsFromJammerRx";
+    return header;
+}
+
+// Krzywa skuteczności wzdłuż trajektorii dla jednego organu: przebieg z jammerem oraz faza 1.
+// Przy ruchomym jammerze faza 1 nie zależy od jego pozycji, więc bierzemy ją z pamięci fazy 1
+// (wypełnionej przez przebieg bazowy); przy ruchomym RX liczymy ją osobnym przebiegiem
+// po tej samej trajektorii. firstSafeDistance to odległość JAM-RX (lub TX-RX) pierwszego okna
+// bez jammingu albo NaN.
+void
+RunTrajectoryScan(SimulationContext& ctx,
+                  const SimulationConfig& baseConfig,
+                  const TrajectoryOptions& trajectory,
+                  const SweepOptions& options,
+                  double jamThreshold,
+                  CsvSink& csv,
+                  double& firstSafeDistance)
+{
+    std::vector<TrajectoryBin> jamBins = RunTrajectory(ctx, baseConfig, trajectory, true);
 
-    if (enableLogs)
+    std::vector<TrajectoryBin> noJamBins;
+    const NoJamPhaseResult* noJamCached = nullptr;
+    ctx.bodyLoss->SetBodyOptions(baseConfig.organOption);
+    auto cached = ctx.noJamCache.find(MakeNoJamPhaseKey(ctx, baseConfig));
+    if (trajectory.moveJam && cached != ctx.noJamCache.end())
     {
-        std::cout << "[BodyPropagationLossModel] organ="
-                  << BodyOrganOptionToString(config.organOption)
-                  << " DoCalcRxPower(txPowerDbm=" << kTxPowerDbm
-                  << ", txPos=" << ctx.mTx->GetPosition()
-                  << ", rxPos=" << ctx.mRx->GetPosition()
-                  << ") = " << bodyRxPowerDbm << " dBm" << std::endl;
-        std::cout << "    -> attenuation due to body = " << bodyLossDb << " dB" << std::endl;
-        std::cout << "    -> jammer path rxPower = " << jamRxPowerDbm << " dBm" << std::endl;
-        std::cout << "    -> jammer path loss = " << jamLossDb << " dB" << std::endl;
-        std::cout << "    -> dielectric params: organConductivity=" << params.organConductivity
-                  << ", organPermittivity=" << params.organPermittivity
-                  << ", skinConductivity=" << params.skinConductivity
-                  << ", skinPermittivity=" << params.skinPermittivity << std::endl;
+        noJamCached = &cached->second;
+    }
+    else
+    {
+        noJamBins = RunTrajectory(ctx, baseConfig, trajectory, false);
     }
 
-    const bool logProgress = enableLogs;
+    firstSafeDistance = std::numeric_limits<double>::quiet_NaN();
+    for (size_t k = 0; k < jamBins.size(); ++k)
+    {
+        const TrajectoryBin& bin = jamBins[k];
+        const Vector mean(bin.sum.x / bin.sent, bin.sum.y / bin.sent, bin.sum.z / bin.sent);
+        const Vector tx(baseConfig.txX, baseConfig.txY, 0.0);
+        const Vector rx = trajectory.moveJam ? Vector(baseConfig.rxX, baseConfig.rxY, 0.0) : mean;
+        const Vector jam = trajectory.moveJam ? mean : Vector(baseConfig.jamX, baseConfig.jamY, baseConfig.jamZ);
+        const double txRxDistance = CalculateDistance(tx, rx);
+        const double jamRxDistance = CalculateDistance(jam, rx);
 
-    Simulator::Schedule(Seconds(0.2), [&, logProgress]() {
-        if (logProgress)
+        // noJamPacketsSent/noJamPacketsRx opisują tę samą próbę co noJamSuccessRate: okno
+        // drugiego przebiegu albo całą fazę 1 z pamięci (wtedy wspólną dla wszystkich okien)
+        uint32_t noJamSent = 0;
+        uint32_t noJamRx = 0;
+        double noJamRate = 0.0;
+        if (noJamCached)
         {
-            std::cout << "=== FAZA 1: BEZ jammingu ===\n";
+            noJamSent = noJamCached->sent;
+            noJamRx = noJamCached->rx;
+            noJamRate = noJamCached->sent ? static_cast<double>(noJamCached->rx) / noJamCached->sent : 0.0;
         }
-        ctx.txDev->GetPhy()->PhySetTRXStateRequest(WbanPhyState::PHY_TX_ON);
-        ctx.rxDev->GetPhy()->PhySetTRXStateRequest(WbanPhyState::PHY_RX_ON);
-        g_jammingActive = false;
-    });
+        else
+        {
+            noJamSent = noJamBins[k].sent;
+            noJamRx = noJamBins[k].rx;
+            noJamRate = static_cast<double>(noJamBins[k].rx) / noJamBins[k].sent;
+        }
+        const double jamRate = static_cast<double>(bin.rx) / bin.sent;
+        const bool jammed = jamRate <= jamThreshold;
+        if (!jammed && std::isnan(firstSafeDistance))
+        {
+            firstSafeDistance = trajectory.moveJam ? jamRxDistance : txRxDistance;
+        }
+
+        CsvRow row;
+        if (options.organColumn)
+        {
+            row << BodyOrganOptionToString(baseConfig.organOption);
+        }
+        row << static_cast<uint32_t>(k) << bin.tStart << bin.tStart + (bin.sent - 1) * kPktGapSeconds << mean.x
+            << mean.y << mean.z << txRxDistance << jamRxDistance << noJamRate << jamRate << (jammed ? 1 : 0)
+            << bin.sent << noJamSent << noJamRx << bin.rx << bin.jamRx;
+        csv.Push(row);
+    }
+    std::cout << "[Trajectory] " << jamBins.size() << " okien w " << (noJamCached ? 1 : 2)
+              << (noJamCached ? " przebiegu" : " przebiegach") << " symulacji" << std::endl;
+}
 
-    for (uint32_t i = 0; i < kNoJamPackets; ++i)
+void
+WardRxIndication(WardScenario* ward, uint32_t link, uint32_t psduLength, Ptr<Packet> p, uint8_t packetSize)
+{
+    BanLink& ban = ward->links[link];
+    const uint64_t uid = p->GetUid();
+    if (uid == ban.txPacketUid)
     {
-        Simulator::Schedule(Seconds(0.5 + i * kPktGapSeconds), [&, i, logProgress]() {
-            Ptr<Packet> p = Create<Packet>(kPayloadBytes);
-            SrcTag tag(SrcTag::TX);
-            p->AddPacketTag(tag);
-            ctx.txDev->GetPhy()->PhyDataRequest(kPayloadBytes, p);
-            ++g_noJamSent;
-            if (logProgress && ((i + 1) % kPrintEvery == 0))
-            {
-                std::cout << "Faza 1: TX wysłano " << (i + 1)
-                          << ", RX odebrał " << g_noJamRx << "\n";
-            }
-        });
+        ++(ward->jammingActive ? ban.jamRxTx : ban.noJamRx);
+    }
+    else if (uid == ward->ctx->jamPacketUid)
+    {
+        ++ban.jamRxJam;
+    }
+    else
+    {
+        // Pakiet innego pacjenta albo podmieniony przez PHY (inny UID) - jak w RxIndication
+        // wracamy do odczytu tagów, a łącze nadawcy rozpoznajemy po BanTag.
+        SrcTag tag;
+        ++ward->tagLookups;
+        if (!p->PeekPacketTag(tag))
+        {
+            return;
+        }
+        if (tag.Get() == SrcTag::JAM)
+        {
+            ++ban.jamRxJam;
+            return;
+        }
+        BanTag banTag;
+        if (p->PeekPacketTag(banTag) && banTag.Get() == link)
+        {
+            ++(ward->jammingActive ? ban.jamRxTx : ban.noJamRx);
+        }
+        else
+        {
+            ++ban.otherBanRx;
+        }
     }
+}
+
+// Buduje N łączy na kanale oddziału (WardSpectrumChannel z łańcuchem strat kontekstu, na który
+// przenosimy też jammery): pacjent k stoi w węźle siatki, TX i RX są przesunięte o (txX, txY)
+// i (rxX, rxY) z baseConfig, a jammery (główny i z --jammerFile) zostają na swoich pozycjach. Każdy implant jest rejestrowany w AddBodyMobility, więc tłumienie ciała dotyczy
+// tylko łączy z implantem. Odbiornikami kanału są tylko RX pacjentów; łącze kontekstu i jammery
+// tylko nadają albo milczą.
+std::unique_ptr<WardScenario>
+CreateWardScenario(SimulationContext& ctx, const SimulationConfig& baseConfig, const WardOptions& options)
+{
+    auto ward = std::make_unique<WardScenario>();
+    ward->ctx = &ctx;
+    ward->options = options;
+    ctx.bodyLoss->SetBodyOptions(baseConfig.organOption);
+    ctx.mJam->SetPosition(Vector(baseConfig.jamX, baseConfig.jamY, baseConfig.jamZ));
+    ctx.channel->RemoveRx(ctx.txDev->GetPhy());
+    ctx.channel->RemoveRx(ctx.rxDev->GetPhy());
+    ctx.channel->RemoveRx(ctx.jamDev->GetPhy());
+    ctx.bodyLoss->ClearBodyMobility();
+    ApplyJamBoost(ctx, baseConfig.jamBoostDb);
 
-    const double phase2Start = 0.5 + kNoJamPackets * kPktGapSeconds + kGapBetweenPhases;
-    const Time phase2StartTime = Seconds(phase2Start);
+    const double txPowerDbm = ctx.parameters.txPowerDbm;
+    ward->range = LinkRange(ctx, txPowerDbm + std::max(0.0, baseConfig.jamBoostDb), options.cutoffDbm);
+    ward->channel = CreateObject<WardSpectrumChannel>();
+    ward->channel->SetRange(ward->range);
+    // ten sam łańcuch strat co w kanale kontekstu (głowa: zaciemnienie albo pathLoss)
+    ward->channel->AddPropagationLossModel(ctx.shadowing ? Ptr<PropagationLossModel>(ctx.shadowing)
+                                                         : Ptr<PropagationLossModel>(ctx.pathLoss));
+    // jammery tylko nadają, więc nie są odbiornikami kanału oddziału
+    ctx.jamDev->SetChannel(ward->channel);
+    ward->channel->RemoveRx(ctx.jamDev->GetPhy());
+    for (ExtraJammer& jammer : ctx.jammers)
+    {
+        jammer.dev->SetChannel(ward->channel);
+        ward->channel->RemoveRx(jammer.dev->GetPhy());
+    }
 
-    Simulator::Schedule(phase2StartTime, [&, logProgress]() {
-        if (logProgress)
+    WbanSpectrumValueHelper svh;
+    Ptr<SpectrumValue> psdTx = svh.CreateTxPowerSpectralDensity(txPowerDbm, kChannelNumber);
+    const uint32_t columns = static_cast<uint32_t>(std::ceil(std::sqrt(static_cast<double>(options.bans))));
+    ward->links.resize(options.bans);
+    for (uint32_t k = 0; k < options.bans; ++k)
+    {
+        BanLink& link = ward->links[k];
+        const double px = (k % columns) * options.spacing;
+        const double py = (k / columns) * options.spacing;
+        link.txNode = CreateObject<Node>();
+        link.rxNode = CreateObject<Node>();
+        link.txDev = CreateObject<WbanNetDevice>();
+        link.rxDev = CreateObject<WbanNetDevice>();
+        link.txDev->SetChannel(ward->channel);
+        link.rxDev->SetChannel(ward->channel);
+        ward->channel->RemoveRx(link.txDev->GetPhy());
+        link.txNode->AddDevice(link.txDev);
+        link.rxNode->AddDevice(link.rxDev);
+        link.mTx = CreateObject<ConstantPositionMobilityModel>();
+        link.mRx = CreateObject<ConstantPositionMobilityModel>();
+        link.mTx->SetPosition(Vector(px + baseConfig.txX, py + baseConfig.txY, 0));
+        link.mRx->SetPosition(Vector(px + baseConfig.rxX, py + baseConfig.rxY, 0));
+        link.txDev->GetPhy()->SetMobility(link.mTx);
+        link.rxDev->GetPhy()->SetMobility(link.mRx);
+        ctx.bodyLoss->AddBodyMobility(link.mTx);
+        link.txDev->GetPhy()->SetTxPowerSpectralDensity(psdTx);
+        link.rxDev->GetPhy()->SetRxSensitivity(ctx.parameters.rxSensitivityDbm);
+        link.rxDev->GetPhy()->SetPhyDataIndicationCallback(
+            MakeBoundCallback(&WardRxIndication, ward.get(), k));
+        link.txTemplate = Create<Packet>(kPayloadBytes);
+        link.txTemplate->AddPacketTag(SrcTag(SrcTag::TX));
+        link.txTemplate->AddPacketTag(BanTag(k));
+        link.txPacketUid = link.txTemplate->GetUid();
+    }
+    return ward;
+}
+
+// Faza 1 (bez jammerów) i faza 2 (jammery nadają co kPktGapSeconds) dla wszystkich łączy naraz.
+// TX pacjenta k startuje z przesunięciem k * kPktGapSeconds / N, więc wysyłki są rozłożone
+// w odstępie między pakietami; nakładanie się sąsiednich BAN jest częścią wyniku.
+void
+RunWardScenario(WardScenario& ward, bool report)
+{
+    SimulationContext& ctx = *ward.ctx;
+    const uint32_t n = static_cast<uint32_t>(ward.links.size());
+    const Time pktGap = Seconds(kPktGapSeconds);
+    Simulator::Schedule(Seconds(0.2), [&ward, &ctx]() {
+        for (BanLink& link : ward.links)
         {
-            std::cout << "\n=== FAZA 2: Z jammerem ===\n";
+            link.txDev->GetPhy()->PhySetTRXStateRequest(WbanPhyState::PHY_TX_ON);
+            link.rxDev->GetPhy()->PhySetTRXStateRequest(WbanPhyState::PHY_RX_ON);
         }
         ctx.jamDev->GetPhy()->PhySetTRXStateRequest(WbanPhyState::PHY_TX_ON);
-        g_jammingActive = true;
+        for (ExtraJammer& jammer : ctx.jammers)
+        {
+            jammer.dev->GetPhy()->PhySetTRXStateRequest(WbanPhyState::PHY_TX_ON);
+        }
+        ward.jammingActive = false;
     });
 
-    for (uint32_t i = 0; i < kWithJamPackets; ++i)
-    {
-        Simulator::Schedule(phase2StartTime + Seconds(i * kPktGapSeconds), [&, logProgress]() {
-            Ptr<Packet> jp = Create<Packet>(32);
-            SrcTag tag(SrcTag::JAM);
-            jp->AddPacketTag(tag);
-            ctx.jamDev->GetPhy()->PhyDataRequest(jp->GetSize(), jp);
-            ++g_jamSentJam;
-        });
-    }
+    const double phase2Start = 0.5 + ctx.parameters.noJamPackets * kPktGapSeconds + kGapBetweenPhases;
+    Simulator::Schedule(Seconds(phase2Start), [&ward]() { ward.jammingActive = true; });
 
-    for (uint32_t i = 0; i < kWithJamPackets; ++i)
+    TrafficSource jamSource;
+    jamSource.Start(Seconds(phase2Start), pktGap, ctx.parameters.withJamPackets, [&ctx](uint32_t) {
+        ctx.jamDev->GetPhy()->PhyDataRequest(ctx.jamTemplate->GetSize(), ctx.jamTemplate->Copy());
+        for (ExtraJammer& jammer : ctx.jammers)
+        {
+            jammer.dev->GetPhy()->PhyDataRequest(ctx.jamTemplate->GetSize(), ctx.jamTemplate->Copy());
+        }
+    });
+    std::vector<TrafficSource> noJamSources(n);
+    std::vector<TrafficSource> jamTxSources(n);
+    for (uint32_t k = 0; k < n; ++k)
     {
-        Simulator::Schedule(phase2StartTime + Seconds(i * kPktGapSeconds), [&, i, logProgress]() {
-            Ptr<Packet> p = Create<Packet>(kPayloadBytes);
-            SrcTag tag(SrcTag::TX);
-            p->AddPacketTag(tag);
-            ctx.txDev->GetPhy()->PhyDataRequest(kPayloadBytes, p);
-            ++g_jamSentTx;
-            if (logProgress && ((i + 1) % kPrintEvery == 0))
-            {
-                std::cout << "Faza 2: TX wysłano " << (i + 1)
-                          << ", RX odebrał TX " << g_jamRxTx
-                          << ", RX odebrał JAM " << g_jamRxJam << "\n";
-            }
+        BanLink& link = ward.links[k];
+        const double offset = k * kPktGapSeconds / n;
+        noJamSources[k].Start(Seconds(0.5 + offset), pktGap, ctx.parameters.noJamPackets, [&link](uint32_t) {
+            link.txDev->GetPhy()->PhyDataRequest(kPayloadBytes, link.txTemplate->Copy());
+            ++link.noJamSent;
+        });
+        jamTxSources[k].Start(Seconds(phase2Start + offset), pktGap, ctx.parameters.withJamPackets, [&link](uint32_t) {
+            link.txDev->GetPhy()->PhyDataRequest(kPayloadBytes, link.txTemplate->Copy());
+            ++link.jamSentTx;
         });
     }
 
-    double simStop = phase2Start + kWithJamPackets * kPktGapSeconds + 1.0;
-    Simulator::Stop(Seconds(simStop));
+    const ProfileSample runBegin = ProfileSample::Now();
+    const uint64_t eventsBegin = Simulator::GetEventCount();
+    EventId stopEvent = Simulator::Stop(Seconds(phase2Start + ctx.parameters.withJamPackets * kPktGapSeconds + 1.0));
     Simulator::Run();
+    stopEvent.Cancel();
+    const ProfileSample runEnd = ProfileSample::Now();
 
-    if (enableLogs)
+    const uint64_t events = Simulator::GetEventCount() - eventsBegin;
+    ward.events = events;
+    ward.runWallSec = runEnd.wallSec - runBegin.wallSec;
+    if (!report)
     {
-        std::cout << "\n=== PODSUMOWANIE ===\n";
-        std::cout << "FAZA 1 (bez jammer’a): TX wysłane " << g_noJamSent
-                  << " | RX odebrał " << g_noJamRx
-                  << " | stracone " << (g_noJamSent - g_noJamRx) << "\n";
-        std::cout << "FAZA 2 (z jammer’em): TX wysłane " << g_jamSentTx
-                  << " | RX odebrał " << g_jamRxTx
-                  << " | stracone " << (g_jamSentTx - g_jamRxTx) << "\n";
-        std::cout << "FAZA 2 (z jammer’em): JAM wysłane " << g_jamSentJam
-                  << " | RX odebrał " << g_jamRxJam
-                  << " | stracone " << (g_jamSentJam - g_jamRxJam) << "\n";
+        return;
     }
+    // Sprawdzenia odległości są wykonywane raz na nadajnik, tylko dla odbiorników z sąsiednich
+    // komórek siatki, więc i one, i zdarzenia rosną z liczbą sąsiadów w zasięgu, a nie z N².
+    std::cout << "[Ward] " << n << " BAN, zasięg odcięcia " << ward.range << " m: " << events
+              << " zdarzeń (" << static_cast<double>(events) / n << " na BAN), dostarczone sygnały "
+              << ward.channel->GetDelivered() << ", sprawdzenia odległości " << ward.channel->GetChecked()
+              << " (listy sąsiadów dla " << ward.channel->GetNeighbourLists() << " nadajników), "
+              << "odczyty tagów przy odbiorze " << ward.tagLookups << ", " << ward.runWallSec << " s" << std::endl;
+}
 
-    SimulationResult result;
-    result.noJamSent = g_noJamSent;
-    result.noJamRx = g_noJamRx;
-    result.jamSentTx = g_jamSentTx;
-    result.jamRxTx = g_jamRxTx;
-    result.jamSentJam = g_jamSentJam;
-    result.jamRxJam = g_jamRxJam;
-    result.bodyRxPowerDbm = bodyRxPowerDbm;
-    result.bodyLossDb = bodyLossDb;
-    result.jamRxPowerDbm = jamRxPowerDbm;
-    result.jamLossDb = jamLossDb;
-    result.params = params;
-    result.txX = config.txX;
-    result.txY = config.txY;
-    result.rxX = config.rxX;
-    result.rxY = config.rxY;
-    result.jamX = config.jamX;
-    result.jamY = config.jamY;
+// Wiersz CSV na łącze (csv == nullptr: tylko podsumowanie).
+void
+WriteWardCsv(const WardScenario& ward, const SimulationConfig& baseConfig, double jamThreshold, CsvSink* csv)
+{
+    const SimulationContext& ctx = *ward.ctx;
+    uint32_t jammed = 0;
+    for (uint32_t k = 0; k < ward.links.size(); ++k)
+    {
+        const BanLink& link = ward.links[k];
+        const Vector rx = link.mRx->GetPosition();
+        double jamRxDistance = CalculateDistance(ctx.mJam->GetPosition(), rx);
+        for (const ExtraJammer& jammer : ctx.jammers)
+        {
+            jamRxDistance = std::min(jamRxDistance, CalculateDistance(jammer.mobility->GetPosition(), rx));
+        }
+        const double noJamRate = link.noJamSent ? static_cast<double>(link.noJamRx) / link.noJamSent : 0.0;
+        const double jamRate = link.jamSentTx ? static_cast<double>(link.jamRxTx) / link.jamSentTx : 0.0;
+        const bool isJammed = jamRate <= jamThreshold;
+        jammed += isJammed ? 1 : 0;
+        if (!csv)
+        {
+            continue;
+        }
 
-    return result;
+        CsvRow row;
+        row << k << link.mTx->GetPosition().x << link.mTx->GetPosition().y << rx.x << rx.y << jamRxDistance
+            << noJamRate << jamRate << (isJammed ? 1 : 0) << link.noJamRx << link.jamRxTx << link.jamRxJam
+            << link.otherBanRx;
+        csv->Push(row);
+    }
+    std::cout << "[Ward] Zagłuszone łącza (prog=" << jamThreshold << "): " << jammed << " z " << ward.links.size()
+              << " (organ " << BodyOrganOptionToString(baseConfig.organOption) << ")" << std::endl;
+}
+
+bool
+WriteProfile(const SimulationContext& ctx, const std::string& profile)
+{
+    if (!ctx.profile)
+    {
+        return true;
+    }
+    fs::path path = ResolveCsvPath(profile);
+    std::error_code ec;
+    if (!path.parent_path().empty())
+    {
+        fs::create_directories(path.parent_path(), ec);
+    }
+    if (ec || !ctx.profile->Write(path))
+    {
+        std::cerr << "[Profile] Nie można zapisać profilu do '" << path.string() << "'" << std::endl;
+        return false;
+    }
+    std::cout << "[Profile] Profil przebiegu zapisano do " << path.string() << std::endl;
+    return true;
 }
 
+// wban-jamming-bench.cc dołącza ten plik z WBAN_JAMMING_NO_MAIN, żeby mierzyć ten sam silnik.
+#ifndef WBAN_JAMMING_NO_MAIN
 int main(int argc, char* argv[])
 {
     double txX = 0.0, txY = 0.0, rxX = 0.3, rxY = 0.0, jamX = 43.0, jamY = 0.0;
@@ -448,6 +4198,26 @@ int main(int argc, char* argv[])
     double scanStep = 0.1;
     double jamThreshold = 0.05;
     std::string scanTarget = "rx";
+    SweepOptions sweep;
+    std::string fastPath = "off";
+    std::string scanMode = "linear";
+    double gridYStart = -1.0;
+    double gridYStop = 1.0;
+    double gridZStart = 0.0;
+    double gridZStop = 0.0;
+    uint32_t gridLevels = 8;
+    bool resume = false;
+    std::string profile;
+    std::string tissueFile;
+    std::string jammerFile;
+    std::string trajectoryFile;
+    TrajectoryOptions trajectory;
+    WardOptions ward;
+    double jamBoostDb = 0.0;
+    PowerSolverOptions power;
+    std::string cacheDir;
+    uint64_t cacheMaxMb = 512;
+    ScenarioParameters parameters;
 
     CommandLine cmd;
     cmd.AddValue("txX", "Pozycja X nadajnika", txX);
@@ -456,15 +4226,111 @@ int main(int argc, char* argv[])
     cmd.AddValue("rxY", "Pozycja Y odbiornika", rxY);
     cmd.AddValue("jamX", "Pozycja X jammer’a", jamX);
     cmd.AddValue("jamY", "Pozycja Y jammer’a", jamY);
-    cmd.AddValue("noJamPackets", "Liczba pakietów bez jammingu", kNoJamPackets);
-    cmd.AddValue("jamPackets", "Liczba pakietów z jammer’a", kWithJamPackets);
-    cmd.AddValue("bodyOrgan", "Model tłumienia dla danego organu (np. heart-402)", bodyOrgan);
+    cmd.AddValue("txPowerDbm", "Moc nadawania TX (dBm)", parameters.txPowerDbm);
+    cmd.AddValue("jamBoostDb", "Moc jammera ponad txPowerDbm (dB)", jamBoostDb);
+    cmd.AddValue("rxSensitivityDbm", "Czułość odbiornika RX (dBm)", parameters.rxSensitivityDbm);
+    cmd.AddValue("noJamPackets", "Liczba pakietów bez jammingu", parameters.noJamPackets);
+    cmd.AddValue("jamPackets", "Liczba pakietów z jammer’a", parameters.withJamPackets);
+    cmd.AddValue("bodyOrgan",
+                 "Model tłumienia dla danego organu (np. heart-402), lista po przecinku lub all "
+                 "(jeden CSV z kolumną organ)",
+                 bodyOrgan);
+    cmd.AddValue("tissueFile",
+                 "Plik bazy tkanek (Cole-Cole lub punkty pomiarowe); jego organy są dostępne w "
+                 "bodyOrgan jako <organ>-<MHz> dla dowolnej częstotliwości",
+                 tissueFile);
+    cmd.AddValue("jammerFile",
+                 "Plik z pozycjami dodatkowych, nieruchomych jammerów (\"x y [z]\" w linii), "
+                 "nadających w fazie 2 razem z jammerem głównym",
+                 jammerFile);
+    cmd.AddValue("jammerCullDbm",
+                 "jammerFile: jammery o mocy u RX poniżej tej wartości (dBm) nie nadają w danym punkcie",
+                 parameters.jammerCullDbm);
+    cmd.AddValue("bans",
+                 "Liczba pacjentów (łączy TX w ciele -> RX na ciele) na wspólnym kanale z jammerami "
+                 "zamiast skanu (0 = wyłączone); CSV z wynikiem każdego łącza",
+                 ward.bans);
+    cmd.AddValue("banSpacing", "bans: odległość między pacjentami na siatce (m)", ward.spacing);
+    cmd.AddValue("banCutoffDbm",
+                 "bans: sygnały słabsze u odbiornika niż ta moc (dBm) nie są dostarczane (odcięcie odległością)",
+                 ward.cutoffDbm);
     cmd.AddValue("scanCsv", "Ścieżka do pliku CSV z przebiegiem skanowania (opcjonalnie)", scanCsv);
     cmd.AddValue("scanStart", "Pozycja początkowa (m) dla skanowanego węzła", scanStart);
     cmd.AddValue("scanStop", "Pozycja końcowa (m) dla skanowanego węzła", scanStop);
     cmd.AddValue("scanStep", "Krok położenia (m) w skanowaniu CSV", scanStep);
     cmd.AddValue("jamThreshold", "Próg (0-1) klasyfikacji jammingu w fazie 2", jamThreshold);
     cmd.AddValue("scanTarget", "Który węzeł skanujemy w CSV: rx lub jam", scanTarget);
+    cmd.AddValue("jobs", "Liczba procesów-workerów skanowania (0 = liczba rdzeni)", sweep.jobs);
+    cmd.AddValue("fastPath",
+                 "Analityczna ścieżka dla punktów o pewnym wyniku: off, on lub validate (obie ścieżki)",
+                 fastPath);
+    cmd.AddValue("fastPathMarginDb",
+                 "Margines (dB) wokół czułości i SIR, w którym punkt uznajemy za niepewny",
+                 sweep.fastPathMarginDb);
+    cmd.AddValue("scanMode",
+                 "Tryb skanowania: linear (każdy punkt), bisect (tylko granica jammingu, "
+                 "z dokładnością scanStep), grid (mapa jamX x jamY z adaptacyjnym podziałem) "
+                 "trajectory (ruchomy węzeł w jednym przebiegu symulacji) lub power (najmniejsze "
+                 "wzmocnienie jammera zagłuszające łącze w każdej pozycji skanu)",
+                 scanMode);
+    cmd.AddValue("powerMinDb", "scanMode=power: najmniejsze sprawdzane wzmocnienie jammera (dB)", power.minDb);
+    cmd.AddValue("powerMaxDb", "scanMode=power: największe sprawdzane wzmocnienie jammera (dB)", power.maxDb);
+    cmd.AddValue("powerStepDb", "scanMode=power: dokładność wzmocnienia jammera (dB)", power.stepDb);
+    cmd.AddValue("trajectoryFile",
+                 "scanMode=trajectory: plik waypointów \"t x y [z]\" ruchomego węzła (puste = ruch "
+                 "wzdłuż X od scanStart do scanStop)",
+                 trajectoryFile);
+    cmd.AddValue("trajectoryBinPackets",
+                 "scanMode=trajectory: liczba pakietów TX w jednym oknie (przy ruchu wzdłuż X okno = scanStep)",
+                 trajectory.binPackets);
+    cmd.AddValue("gridYStart", "scanMode=grid: początek zakresu Y jammera (m)", gridYStart);
+    cmd.AddValue("gridYStop", "scanMode=grid: koniec zakresu Y jammera (m)", gridYStop);
+    cmd.AddValue("gridZStart", "scanMode=grid: początek zakresu Z jammera (m)", gridZStart);
+    cmd.AddValue("gridZStop", "scanMode=grid: koniec zakresu Z jammera (m, > gridZStart = octree)", gridZStop);
+    cmd.AddValue("gridLevels", "scanMode=grid: liczba podziałów komórki zgrubnej (bok scanStep*2^N)", gridLevels);
+    cmd.AddValue("earlyStop",
+                 "Kończ fazę 2, gdy przedział Wilsona skuteczności rozstrzyga isJammed, a fazę 1, gdy "
+                 "przedział jest wąski (earlyStopNoJamWidth)",
+                 parameters.earlyStop.enabled);
+    cmd.AddValue("earlyStopConfidence", "earlyStop: ufność decyzji fazy (0.5-1)", parameters.earlyStop.confidence);
+    cmd.AddValue("earlyStopBatch", "earlyStop: co ile wysłanych pakietów sprawdzać przedział", parameters.earlyStop.batch);
+    cmd.AddValue("earlyStopNoJamWidth",
+                 "earlyStop: faza 1 kończy się, gdy połowa szerokości przedziału noJamSuccessRate jest <= tej wartości",
+                 parameters.earlyStop.noJamHalfWidth);
+    cmd.AddValue("reuseNoJamPhase",
+                 "Licz fazę 1 (bez jammera) raz dla danych pozycji TX/RX i organu i używaj jej ponownie",
+                 parameters.reuseNoJamPhase);
+    cmd.AddValue("dedupScan",
+                 "Symuluj raz każdą parę odległości TX-RX/JAM-RX (np. pozycje lustrzane) i kopiuj wynik",
+                 sweep.dedup);
+    cmd.AddValue("resume",
+                 "Prowadź dziennik <scanCsv>.journal i wznów przerwany skan, pomijając zapisane w nim punkty",
+                 resume);
+    cmd.AddValue("checkpointEvery",
+                 "Co ile symulowanych punktów dopisywać i utrwalać (fsync) dziennik skanu (0 = bez dziennika, "
+                 "a przy resume 256)",
+                 sweep.checkpointEvery);
+    cmd.AddValue("shadowingSigmaDb",
+                 "Odchylenie (dB) losowego zaciemnienia dodawanego do strat LogDistance, losowanego "
+                 "raz na łącze w punkcie skanu (0 = kanał deterministyczny)",
+                 parameters.shadowingSigmaDb);
+    cmd.AddValue("bodyShadowingSigmaDb",
+                 "Odchylenie (dB) losowego zaciemnienia tłumienia ciała, losowanego raz na łącze "
+                 "w punkcie skanu (0 = deterministyczne)",
+                 parameters.bodyShadowingSigmaDb);
+    cmd.AddValue("replications",
+                 "Liczba niezależnych replikacji każdego punktu skanu liniowego (wiersz CSV ze średnią "
+                 "i 95% przedziałem ufności); wyniki zależą tylko od RngSeed/RngRun",
+                 parameters.replications);
+    cmd.AddValue("cacheDir",
+                 "Katalog trwałej pamięci wyników punktów między uruchomieniami (ścieżka względna jak "
+                 "dla scanCsv; puste = bez pamięci)",
+                 cacheDir);
+    cmd.AddValue("cacheMaxMb", "cacheDir: limit rozmiaru katalogu (MB), po przekroczeniu usuwane są najdawniej używane wyniki", cacheMaxMb);
+    cmd.AddValue("profile",
+                 "Plik JSON z czasami faz i punktów, zdarzeniami/s, głębokością kolejki zdarzeń, "
+                 "liczbą pakietów i bajtów CSV (puste = bez profilowania)",
+                 profile);
     cmd.Parse(argc, argv);
 
     if (scanStep <= 0.0)
@@ -473,20 +4339,207 @@ int main(int argc, char* argv[])
         return 1;
     }
     jamThreshold = std::max(0.0, std::min(1.0, jamThreshold));
+    if (parameters.earlyStop.confidence <= 0.5 || parameters.earlyStop.confidence >= 1.0 || parameters.earlyStop.batch == 0 ||
+        parameters.earlyStop.noJamHalfWidth <= 0.0)
+    {
+        std::cerr << "[CLI] earlyStopConfidence musi być w (0.5, 1), earlyStopBatch > 0, a earlyStopNoJamWidth > 0"
+                  << std::endl;
+        return 1;
+    }
+    parameters.earlyStop.threshold = jamThreshold;
+    if (sweep.jobs == 0)
+    {
+        sweep.jobs = std::max(1u, std::thread::hardware_concurrency());
+    }
+    if (resume && sweep.checkpointEvery == 0)
+    {
+        sweep.checkpointEvery = 256;
+    }
+    std::string fastPathKey = ToLower(fastPath);
+    if (fastPathKey == "on" || fastPathKey == "1")
+    {
+        sweep.fastPath = FastPathMode::ON;
+    }
+    else if (fastPathKey == "validate")
+    {
+        sweep.fastPath = FastPathMode::VALIDATE;
+    }
+    else if (fastPathKey != "off" && fastPathKey != "0")
+    {
+        std::cerr << "[CLI] Nieznany fastPath '" << fastPath << "' (dozwolone: off, on, validate)" << std::endl;
+        return 1;
+    }
+    if (sweep.fastPathMarginDb < 0.0)
+    {
+        std::cerr << "[CLI] fastPathMarginDb musi być >= 0" << std::endl;
+        return 1;
+    }
     std::string scanTargetKey = ToLower(scanTarget);
     bool scanJam = (scanTargetKey == "jam" || scanTargetKey == "jammer" || scanTargetKey == "j");
+    std::string scanModeKey = ToLower(scanMode);
+    bool scanBisect = (scanModeKey == "bisect" || scanModeKey == "bisection");
+    bool scanGrid = (scanModeKey == "grid");
+    bool scanTrajectory = (scanModeKey == "trajectory");
+    bool scanPower = (scanModeKey == "power" || scanModeKey == "solver");
+    if (!scanBisect && !scanGrid && !scanTrajectory && !scanPower && scanModeKey != "linear")
+    {
+        std::cerr << "[CLI] Nieznany scanMode '" << scanMode
+                  << "' (dozwolone: linear, bisect, grid, trajectory, power)" << std::endl;
+        return 1;
+    }
+    if (scanPower && (power.stepDb <= 0.0 || power.maxDb < power.minDb))
+    {
+        std::cerr << "[CLI] powerStepDb musi być > 0, a powerMaxDb >= powerMinDb" << std::endl;
+        return 1;
+    }
+    if (scanTrajectory)
+    {
+        trajectory.moveJam = scanJam;
+        if (trajectory.binPackets == 0)
+        {
+            std::cerr << "[CLI] trajectoryBinPackets musi być > 0" << std::endl;
+            return 1;
+        }
+        if (!trajectoryFile.empty() && !LoadTrajectory(trajectoryFile, trajectory.waypoints))
+        {
+            return 1;
+        }
+    }
+    if (scanGrid && gridLevels > 20)
+    {
+        std::cerr << "[CLI] gridLevels musi być <= 20" << std::endl;
+        return 1;
+    }
+
+    parameters.baseRun = RngSeedManager::GetRun();
+    if (parameters.shadowingSigmaDb < 0.0 || parameters.bodyShadowingSigmaDb < 0.0 || parameters.replications == 0)
+    {
+        std::cerr << "[CLI] shadowingSigmaDb i bodyShadowingSigmaDb muszą być >= 0, a replications > 0" << std::endl;
+        return 1;
+    }
+    if (parameters.replications > 1 && !parameters.IsStochastic())
+    {
+        std::cerr << "[CLI] replications > 1 wymaga zaciemnienia (shadowingSigmaDb lub bodyShadowingSigmaDb > 0), "
+                     "bez niego replikacje są identyczne" << std::endl;
+        return 1;
+    }
+    if (parameters.replications > 1 && (scanBisect || scanGrid || scanTrajectory || scanPower || ward.bans > 0))
+    {
+        std::cerr << "[CLI] replications działa tylko w skanie liniowym" << std::endl;
+        return 1;
+    }
+    if (parameters.IsStochastic())
+    {
+        // Fast path, sygnatury dedupScan i pamięć fazy 1 zakładają kanał deterministyczny.
+        if (sweep.fastPath != FastPathMode::OFF || sweep.dedup)
+        {
+            std::cerr << "[CLI] zaciemnienie nie łączy się z fastPath ani dedupScan" << std::endl;
+            return 1;
+        }
+        parameters.reuseNoJamPhase = false;
+    }
+
+    if (!tissueFile.empty())
+    {
+        std::string error;
+        if (!GetTissueDatabase().Load(tissueFile, error))
+        {
+            std::cerr << "[Tissue] " << error << std::endl;
+            return 1;
+        }
+    }
+
+    if (!jammerFile.empty())
+    {
+        if (!LoadJammerPositions(jammerFile, parameters.jammerPositions))
+        {
+            return 1;
+        }
+        // Fast path i sygnatura --dedupScan opisują tylko jammer główny.
+        if (sweep.fastPath != FastPathMode::OFF || sweep.dedup)
+        {
+            std::cerr << "[CLI] jammerFile nie łączy się z fastPath ani dedupScan" << std::endl;
+            return 1;
+        }
+    }
+
+    std::vector<BodyOrganOption> organs;
+    if (!ParseBodyOrganList(bodyOrgan, organs))
+    {
+        return 1;
+    }
+    sweep.organColumn = organs.size() > 1;
+    if (ward.bans > 0 && (organs.size() > 1 || ward.spacing <= 0.0))
+    {
+        std::cerr << "[CLI] bans wymaga jednego organu i banSpacing > 0" << std::endl;
+        return 1;
+    }
+
+    ScanProfile profiler;
+    if (!profile.empty())
+    {
+        ObjectFactory scheduler;
+        scheduler.SetTypeId(ProfilingScheduler::GetTypeId());
+        Simulator::SetScheduler(scheduler);
+    }
 
-    BodyOrganOption organOption = ParseBodyOrganOption(bodyOrgan);
+    // Organ jest częścią SimulationConfig, więc jeden kontekst (węzły, kanał, szablony pakietów)
+    // obsługuje wszystkie organy z listy.
+    ProfileSample phaseBegin = ProfileSample::Now();
+    std::unique_ptr<SimulationContext> context = CreateSimulationContext(organs.front(), parameters);
+    SimulationContext& ctx = *context;
+    ctx.profile = profile.empty() ? nullptr : &profiler;
+    profiler.AddPhase("context", phaseBegin);
 
-    SimulationContext ctx = CreateSimulationContext(organOption);
+    phaseBegin = ProfileSample::Now();
+    std::vector<SimulationConfig> baseConfigs;
+    for (BodyOrganOption organOption : organs)
+    {
+        baseConfigs.push_back(SimulationConfig{txX, txY, rxX, rxY, jamX, jamY, organOption});
+        baseConfigs.back().jamBoostDb = jamBoostDb;
+    }
+    // Pełny przebieg z logami tylko dla pierwszego organu: przy liście organów skan i tak liczy
+    // każdy z nich, a kolejne przebiegi bazowe dawałyby tylko powtórzone podsumowania.
+    RunScenario(ctx, baseConfigs.front(), true);
+    profiler.AddPhase("baseRun", phaseBegin);
 
-    SimulationConfig baseConfig{txX, txY, rxX, rxY, jamX, jamY, organOption};
-    RunScenario(ctx, baseConfig, true);
+    if (ward.bans > 0)
+    {
+        // Kanał kontekstu jest przebudowywany na scenariusz oddziału, więc to ostatni przebieg.
+        std::unique_ptr<WardScenario> wardScenario = CreateWardScenario(ctx, baseConfigs.front(), ward);
+        RunWardScenario(*wardScenario, true);
+        if (!scanCsv.empty())
+        {
+            fs::path wardCsvPath = ResolveCsvPath(scanCsv);
+            std::error_code ec;
+            fs::create_directories(wardCsvPath.parent_path(), ec);
+            CsvSink csv;
+            if (!csv.Open(wardCsvPath,
+                          "link,txX,txY,rxX,rxY,nearestJamRxDistance,noJamSuccessRate,jamSuccessRate,isJammed,"
+                          "noJamPacketsRx,jamPacketsRx,jamPacketsFromJammerRx,otherBanPacketsRx"))
+            {
+                std::cerr << "[CSV] Nie można otworzyć pliku '" << wardCsvPath.string() << "' do zapisu" << std::endl;
+                return 1;
+            }
+            WriteWardCsv(*wardScenario, baseConfigs.front(), jamThreshold, &csv);
+            if (!csv.Close())
+            {
+                std::cerr << "[CSV] Błąd zapisu do pliku '" << wardCsvPath.string() << "'" << std::endl;
+                return 1;
+            }
+            std::cout << "[CSV] Wyniki łączy zapisano do " << wardCsvPath.string() << std::endl;
+        }
+        else
+        {
+            WriteWardCsv(*wardScenario, baseConfigs.front(), jamThreshold, nullptr);
+        }
+        Simulator::Destroy();
+        return 0;
+    }
 
     fs::path scanCsvPath = ResolveCsvPath(scanCsv);
     if (!scanCsv.empty() && scanStop >= scanStart)
     {
-        SimulationConfig scanConfig = baseConfig;
         fs::path parent = scanCsvPath.parent_path();
         if (!parent.empty())
         {
@@ -500,78 +4553,281 @@ int main(int argc, char* argv[])
             }
         }
 
-        std::ofstream csv(scanCsvPath);
-        if (!csv.is_open())
+        CsvSink csv;
+        const std::string header = scanGrid         ? GridCsvHeader(ctx, sweep)
+                                   : scanTrajectory ? TrajectoryCsvHeader(sweep)
+                                   : scanPower      ? PowerCsvHeader(sweep)
+                                                    : ScanCsvHeader(ctx, sweep);
+        if (!csv.Open(scanCsvPath, header))
         {
             std::cerr << "[CSV] Nie można otworzyć pliku '" << scanCsvPath.string() << "' do zapisu" << std::endl;
             return 1;
         }
+        ctx.csvSink = &csv;
 
-        csv << "rxX,rxY,txRxDistance,rxJamDistance,scanCoordinate,bodyLossDb,bodyRxPowerDbm,jamRxPowerDbm,jamLossDb,noJamSuccessRate,jamSuccessRate,isJammed,noJamPacketsRx,jamPacketsRx,jamPacketsFromJammerRx\n";
+        ScanJournal journal;
+        if (sweep.checkpointEvery > 0)
+        {
+            fs::path journalPath = scanCsvPath;
+            journalPath += ".journal";
+            if (!journal.Open(journalPath, JournalFingerprint(ctx, sweep), resume))
+            {
+                return 1;
+            }
+            sweep.journal = &journal;
+        }
 
-        double firstSafeDistance = std::numeric_limits<double>::quiet_NaN();
-        const double epsilon = scanStep * 0.5;
+        ResultCache cache;
+        if (!cacheDir.empty())
+        {
+            if (!cache.Open(ResolveCsvPath(cacheDir), cacheMaxMb << 20, ScenarioFingerprint(ctx)))
+            {
+                return 1;
+            }
+            sweep.cache = &cache;
+        }
 
-        for (double scanPos = scanStart; scanPos <= scanStop + epsilon; scanPos += scanStep)
+        phaseBegin = ProfileSample::Now();
+        if (scanGrid)
         {
-            if (scanJam)
+            GridScanOptions grid{scanStart, scanStop, gridYStart, gridYStop, gridZStart, gridZStop,
+                                 scanStep, gridLevels};
+            for (const SimulationConfig& baseConfig : baseConfigs)
             {
-                scanConfig.jamX = scanPos;
-                scanConfig.rxX = baseConfig.rxX;
-                scanConfig.jamY = baseConfig.jamY;
-                scanConfig.rxY = baseConfig.rxY;
+                if (!RunGridScan(ctx, baseConfig, grid, sweep, jamThreshold, csv))
+                {
+                    return 1;
+                }
             }
-            else
+            ctx.csvSink = nullptr;
+            if (!csv.Close())
+            {
+                std::cerr << "[CSV] Błąd zapisu do pliku '" << scanCsvPath.string() << "'" << std::endl;
+                return 1;
+            }
+            profiler.AddPhase("sweep", phaseBegin);
+            profiler.AddCsv(csv);
+            journal.Remove();
+            std::cout << "[CSV] Mapę jammingu zapisano do " << scanCsvPath.string() << std::endl;
+            ReportJournal(ctx);
+            if (sweep.cache)
             {
-                scanConfig.rxX = scanPos;
-                scanConfig.rxY = baseConfig.rxY;
-                scanConfig.jamX = baseConfig.jamX;
-                scanConfig.jamY = baseConfig.jamY;
+                sweep.cache->Report();
             }
-            SimulationResult res = RunScenario(ctx, scanConfig, false);
+            ReportFastPath(ctx, sweep);
+            ReportPacketStats(ctx);
+            ReportJammers(ctx);
+            if (!WriteProfile(ctx, profile))
+            {
+                return 1;
+            }
+            Simulator::Destroy();
+            return 0;
+        }
 
-            double scanCoordinate = scanPos;
+        std::vector<double> firstSafeDistances(organs.size(), std::numeric_limits<double>::quiet_NaN());
 
-            double noJamRate = res.noJamSent ? static_cast<double>(res.noJamRx) / res.noJamSent : 0.0;
-            double jamRate = res.jamSentTx ? static_cast<double>(res.jamRxTx) / res.jamSentTx : 0.0;
-            bool jammed = jamRate <= jamThreshold;
-            double txRxDistance = std::hypot(res.rxX - res.txX, res.rxY - res.txY);
-            double jamRxDistance = std::hypot(res.rxX - res.jamX, res.rxY - res.jamY);
+        std::vector<double> scanPositions = BuildScanPositions(scanStart, scanStop, scanStep);
+        std::vector<std::vector<SimulationConfig>> scanConfigs(organs.size());
+        for (size_t o = 0; o < organs.size(); ++o)
+        {
+            scanConfigs[o].reserve(scanPositions.size());
+            for (double scanPos : scanPositions)
+            {
+                scanConfigs[o].push_back(MakeScanConfig(baseConfigs[o], scanJam, scanPos));
+            }
+        }
+
+        if (scanTrajectory)
+        {
+            for (size_t o = 0; o < organs.size(); ++o)
+            {
+                TrajectoryOptions organTrajectory = trajectory;
+                if (trajectoryFile.empty())
+                {
+                    BuildLinearTrajectory(baseConfigs[o], scanStart, scanStop, scanStep, organTrajectory);
+                }
+                RunTrajectoryScan(ctx, baseConfigs[o], organTrajectory, sweep, jamThreshold, csv, firstSafeDistances[o]);
+            }
+        }
+        else if (scanPower)
+        {
+            // Granica mocy: organy po kolei, w każdej rundzie bisekcji --jobs wzmocnień naraz.
+            for (size_t o = 0; o < organs.size(); ++o)
+            {
+                if (!RunPowerSolver(ctx, scanConfigs[o], scanPositions, scanJam, power, sweep, jamThreshold, csv))
+                {
+                    return 1;
+                }
+            }
+        }
+        else if (scanBisect)
+        {
+            // Bisekcja jest adaptacyjna, więc organy idą po kolei; każda runda korzysta z --jobs.
+            // Skan jammera przechodzący przez pozycję RX zmienia isJammed dwa razy (bez jammingu ->
+            // jamming -> bez jammingu), więc dzielimy go w RX na dwie strony, każdą przeszukiwaną
+            // od RX na zewnątrz. Próg to większa z odległości obu stron.
+            for (size_t o = 0; o < organs.size(); ++o)
+            {
+                const size_t split =
+                    scanJam ? std::lower_bound(scanPositions.begin(), scanPositions.end(), baseConfigs[o].rxX) -
+                                  scanPositions.begin()
+                            : 0;
+                std::vector<std::vector<size_t>> sides(2);
+                for (size_t i = split; i-- > 0;)
+                {
+                    sides[0].push_back(i);
+                }
+                for (size_t i = split; i < scanPositions.size(); ++i)
+                {
+                    sides[1].push_back(i);
+                }
 
-            csv << res.rxX << ',' << res.rxY << ',' << txRxDistance << ',' << jamRxDistance << ','
-                << scanCoordinate << ',' << res.bodyLossDb << ',' << res.bodyRxPowerDbm << ','
-                << res.jamRxPowerDbm << ',' << res.jamLossDb << ','
-                << noJamRate << ',' << jamRate << ',' << (jammed ? 1 : 0) << ','
-                << res.noJamRx << ',' << res.jamRxTx << ',' << res.jamRxJam << '\n';
+                std::map<size_t, SimulationResult> rows;
+                bool safeFound = true;
+                double threshold = 0.0;
+                for (const std::vector<size_t>& side : sides)
+                {
+                    if (side.empty())
+                    {
+                        continue;
+                    }
+                    std::vector<SimulationConfig> sideConfigs;
+                    for (size_t index : side)
+                    {
+                        sideConfigs.push_back(scanConfigs[o][index]);
+                    }
+                    std::map<size_t, SimulationResult> evaluated;
+                    size_t firstSafe = 0;
+                    if (!FindFirstSafeIndex(ctx, sideConfigs, sweep, jamThreshold, evaluated, firstSafe))
+                    {
+                        return 1;
+                    }
+                    for (const auto& [k, res] : evaluated)
+                    {
+                        rows[side[k]] = res;
+                    }
+                    if (firstSafe < side.size())
+                    {
+                        threshold = std::max(threshold, ScanDistance(evaluated[firstSafe], scanJam));
+                    }
+                    else
+                    {
+                        safeFound = false;
+                    }
+                }
+                for (const auto& [index, res] : rows)
+                {
+                    WriteScanCsvRow(ctx, csv, res, scanPositions[index], jamThreshold, sweep);
+                }
+                if (safeFound && !rows.empty())
+                {
+                    firstSafeDistances[o] = threshold;
+                }
+                std::cout << "[Bisect] Wykonano " << rows.size() << " symulacji zamiast "
+                          << scanConfigs[o].size() << std::endl;
+            }
+        }
+        else
+        {
+            // Punkty wszystkich organów w jednej partii: workery nie czekają na koniec organu.
+            // Przy --replications każdy punkt występuje R razy z kolejnymi numerami replikacji,
+            // więc replikacje są rozdzielane między workery jak zwykłe punkty.
+            const uint32_t replications = ctx.parameters.replications;
+            std::vector<SimulationConfig> batch;
+            batch.reserve(organs.size() * scanPositions.size() * replications);
+            for (const auto& configs : scanConfigs)
+            {
+                for (const SimulationConfig& config : configs)
+                {
+                    for (uint32_t r = 0; r < replications; ++r)
+                    {
+                        batch.push_back(config);
+                        batch.back().replication = r;
+                    }
+                }
+            }
+            std::vector<SimulationResult> scanResults;
+            if (!RunScenarioBatch(ctx, batch, sweep, scanResults))
+            {
+                return 1;
+            }
+            if (replications > 1)
+            {
+                std::vector<SimulationResult> summaries;
+                summaries.reserve(scanResults.size() / replications);
+                for (size_t i = 0; i < scanResults.size(); i += replications)
+                {
+                    summaries.push_back(SummarizeReplications(&scanResults[i], replications));
+                }
+                scanResults.swap(summaries);
+            }
 
-            if (!jammed && std::isnan(firstSafeDistance))
+            for (size_t i = 0; i < scanResults.size(); ++i)
             {
-                firstSafeDistance = scanJam ? jamRxDistance : txRxDistance;
+                const SimulationResult& res = scanResults[i];
+                size_t o = i / scanPositions.size();
+                WriteScanCsvRow(ctx, csv, res, scanPositions[i % scanPositions.size()], jamThreshold, sweep);
+
+                if (!IsJammed(res, jamThreshold) && std::isnan(firstSafeDistances[o]))
+                {
+                    firstSafeDistances[o] = ScanDistance(res, scanJam);
+                }
             }
         }
 
-        csv.close();
+        ctx.csvSink = nullptr;
+        if (!csv.Close())
+        {
+            std::cerr << "[CSV] Błąd zapisu do pliku '" << scanCsvPath.string() << "'" << std::endl;
+            return 1;
+        }
+        profiler.AddPhase("sweep", phaseBegin);
+        profiler.AddCsv(csv);
+        journal.Remove();
         std::cout << "[CSV] Wyniki skanowania zapisano do " << scanCsvPath.string() << std::endl;
-        if (!std::isnan(firstSafeDistance))
+        ReportJournal(ctx);
+        if (sweep.cache)
+        {
+            sweep.cache->Report();
+        }
+        ReportFastPath(ctx, sweep);
+        ReportPacketStats(ctx);
+        ReportJammers(ctx);
+        // --scanMode=power nie szuka progowej odległości (granica jest w CSV)
+        for (size_t o = 0; o < (scanPower ? 0 : organs.size()); ++o)
         {
-            if (scanJam)
+            std::string tag = "[Threshold] ";
+            if (sweep.organColumn)
             {
-                std::cout << "[Threshold] Minimalna odległość JAM-RX dająca brak jammingu (prog="
-                          << jamThreshold << ") ≈ " << firstSafeDistance << " m" << std::endl;
+                tag += std::string(BodyOrganOptionToString(organs[o])) + ": ";
+            }
+            if (!std::isnan(firstSafeDistances[o]))
+            {
+                if (scanJam)
+                {
+                    std::cout << tag << "Minimalna odległość JAM-RX dająca brak jammingu (prog="
+                              << jamThreshold << ") ≈ " << firstSafeDistances[o] << " m" << std::endl;
+                }
+                else
+                {
+                    std::cout << tag << "Pierwsza pozycja RX poza strefą jammingu (prog=" << jamThreshold
+                              << ") dla odległości TX-RX ≈ " << firstSafeDistances[o] << " m" << std::endl;
+                }
             }
             else
             {
-                std::cout << "[Threshold] Pierwsza pozycja RX poza strefą jammingu (prog=" << jamThreshold
-                          << ") dla odległości TX-RX ≈ " << firstSafeDistance << " m" << std::endl;
+                std::cout << tag << "W zadanym zakresie obiekt pozostaje w strefie jammingu (prog="
+                          << jamThreshold << ")" << std::endl;
             }
         }
-        else
-        {
-            std::cout << "[Threshold] W zadanym zakresie obiekt pozostaje w strefie jammingu (prog="
-                      << jamThreshold << ")" << std::endl;
-        }
     }
 
+    if (!WriteProfile(ctx, profile))
+    {
+        return 1;
+    }
     Simulator::Destroy();
     return 0;
 }
+#endif // WBAN_JAMMING_NO_MAIN
@@ -15,8 +15,17 @@
 #include "ns3/pointer.h"
 #include "ns3/string.h"
 
+#include <algorithm>
 #include <cmath>
+#include <complex>
+#include <fstream>
 #include <math.h>
+#include <sstream>
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#include <immintrin.h>
+#define WBAN_BATCH_X86 1
+#endif
 
 namespace ns3
 {
@@ -151,9 +160,63 @@ static const BodyDielectricParameters DielectricParameters[] = {
      0.0013,
      402}};
 
+static_assert(sizeof(DielectricParameters) / sizeof(DielectricParameters[0]) ==
+                  BodyPropagationLossModel::BUILTIN_BODY_OPTIONS,
+              "BUILTIN_BODY_OPTIONS must match the built-in dielectric table");
+
+namespace
+{
+
+/**
+ * A row of the dielectric table with the attenuation terms of UpdateBodyLoss()
+ * that do not depend on the configured layer counts, in dB.
+ */
+struct DielectricRow
+{
+    BodyDielectricParameters parameters; //!< the row as given
+    double organDb;                      //!< organ attenuation
+    double muscleDb;                     //!< muscle attenuation per configured muscle layer
+    double fatDb;                        //!< fat attenuation per configured fat layer
+    double skinDb;                       //!< skin attenuation
+};
+
+// attenuation constant = (520.8𝜋𝜃 / √𝜖𝑟) * d, see BodyPropagationLossModel::DoCalcRxPower()
+DielectricRow
+MakeDielectricRow(const BodyDielectricParameters& p)
+{
+    DielectricRow row;
+    row.parameters = p;
+    row.organDb = (520.8 * M_PI * p.organConductivity) / pow(p.organPermittivity, 0.5) *
+                  p.organThickness;
+    row.muscleDb = (520.8 * M_PI * p.muscleConductivity) / pow(p.musclePermittivity, 0.5) *
+                   p.muscleThickness * p.muscleLayer;
+    row.fatDb = (520.8 * M_PI * p.fatConductivity) / pow(p.fatPermittivity, 0.5) *
+                p.fatThickness * p.fatLayer;
+    row.skinDb = (520.8 * M_PI * p.skinConductivity) / pow(p.skinPermittivity, 0.5) *
+                 p.skinThickness;
+    return row;
+}
+
+std::vector<DielectricRow>&
+GetDielectricRows()
+{
+    static std::vector<DielectricRow> rows = [] {
+        std::vector<DielectricRow> builtin;
+        for (const BodyDielectricParameters& parameters : DielectricParameters)
+        {
+            builtin.push_back(MakeDielectricRow(parameters));
+        }
+        return builtin;
+    }();
+    return rows;
+}
+
+} // namespace
+
 NS_LOG_COMPONENT_DEFINE("WbanPropagationLossModel");
 
 NS_OBJECT_ENSURE_REGISTERED(BodyPropagationLossModel);
+NS_OBJECT_ENSURE_REGISTERED(LinkShadowingPropagationLossModel);
 
 TypeId
 BodyPropagationLossModel::GetTypeId()
@@ -161,21 +224,63 @@ BodyPropagationLossModel::GetTypeId()
     static TypeId tid = TypeId("ns3::BodyPropagationLossModel")
                             .SetParent<PropagationLossModel>()
                             .SetGroupName("Propagation")
-                            .AddConstructor<BodyPropagationLossModel>();
+                            .AddConstructor<BodyPropagationLossModel>()
+                            .AddAttribute("ShadowingSigmaDb",
+                                          "Standard deviation (dB) of the zero-mean normal "
+                                          "shadowing of links that cross the body, drawn once "
+                                          "per link until the next AssignStreams(); "
+                                          "0 keeps the body loss deterministic",
+                                          DoubleValue(0.0),
+                                          MakeDoubleAccessor(&BodyPropagationLossModel::m_shadowingSigmaDb),
+                                          MakeDoubleChecker<double>(0.0));
     return tid;
 }
 
 BodyPropagationLossModel::BodyPropagationLossModel()
 {
+    m_shadowing = CreateObject<NormalRandomVariable>();
+    m_shadowing->SetAttribute("Mean", DoubleValue(0.0));
+    m_shadowing->SetAttribute("Variance", DoubleValue(1.0));
     SetBodyOptions(BodyOrganOption::SMALL_INTESTINE_402_MHZ);
 }
 
+BodyOrganOption
+BodyPropagationLossModel::AddBodyOption(const BodyDielectricParameters& parameters)
+{
+    std::vector<DielectricRow>& rows = GetDielectricRows();
+    // The layer counts of an added row are the organ's own (TissueDatabase::Materialize()).
+    // SetBodyOptions() copies them into m_parameters and UpdateBodyLoss() multiplies by them,
+    // so the row keeps the terms of a single layer, otherwise each layer would count N times.
+    BodyDielectricParameters perLayer = parameters;
+    perLayer.muscleLayer = 1;
+    perLayer.fatLayer = 1;
+    DielectricRow row = MakeDielectricRow(perLayer);
+    row.parameters = parameters;
+    rows.push_back(row);
+    NS_LOG_DEBUG("body option " << rows.size() - 1 << " at " << parameters.frequency << " MHz");
+    return static_cast<BodyOrganOption>(rows.size() - 1);
+}
+
+uint32_t
+BodyPropagationLossModel::GetBodyOptionCount()
+{
+    return GetDielectricRows().size();
+}
+
+const BodyDielectricParameters&
+BodyPropagationLossModel::GetDielectricParameters(BodyOrganOption bodyOption)
+{
+    auto index = static_cast<uint32_t>(bodyOption);
+    NS_ASSERT_MSG(index < GetDielectricRows().size(), "unknown body option " << index);
+    return GetDielectricRows()[index].parameters;
+}
+
 void
 BodyPropagationLossModel::SetBodyOptions(BodyOrganOption bodyOption)
 {
     m_bodyOption = bodyOption;
-    auto index = static_cast<uint32_t>(m_bodyOption);
-    m_parameters = DielectricParameters[index];
+    m_parameters = GetDielectricParameters(bodyOption);
+    UpdateBodyLoss();
 }
 
 BodyOrganOption
@@ -190,6 +295,7 @@ BodyPropagationLossModel::SetFatLayer(uint32_t fatLayer)
 {
     m_parameters.fatLayer = fatLayer;
     NS_LOG_DEBUG("new fat layer = " << fatLayer);
+    UpdateBodyLoss();
 }
 
 uint32_t
@@ -203,6 +309,7 @@ BodyPropagationLossModel::SetMuscleLayer(uint32_t muscleLayer)
 {
     m_parameters.muscleLayer = muscleLayer;
     NS_LOG_DEBUG("new muscle layer = " << muscleLayer);
+    UpdateBodyLoss();
 }
 
 uint32_t
@@ -211,6 +318,18 @@ BodyPropagationLossModel::GetMuscleLayer() const
     return m_parameters.muscleLayer;
 }
 
+double
+BodyPropagationLossModel::GetBodyLossDb() const
+{
+    return m_bodyLossDb;
+}
+
+double
+BodyPropagationLossModel::GetLinkBodyLossDb(Ptr<MobilityModel> a, Ptr<MobilityModel> b) const
+{
+    return ShouldApplyBodyLoss(a, b) ? m_bodyLossDb : 0.0;
+}
+
 void
 BodyPropagationLossModel::AddBodyMobility(Ptr<MobilityModel> mobility)
 {
@@ -218,30 +337,114 @@ BodyPropagationLossModel::AddBodyMobility(Ptr<MobilityModel> mobility)
     {
         return;
     }
-    m_bodyMobility.insert(PeekPointer(mobility));
+    const MobilityModel* model = PeekPointer(mobility);
+    if (IsBodyMobility(model))
+    {
+        return;
+    }
+    m_bodyMobility.push_back(model);
     m_useSelectiveAttenuation = true;
+
+    // at least one bucket per registered model; more if the hash overfills a bucket
+    uint32_t bucketBits = 1;
+    while ((uint64_t{1} << bucketBits) < m_bodyMobility.size())
+    {
+        ++bucketBits;
+    }
+    while (!BuildBodyMobilityBuckets(bucketBits))
+    {
+        ++bucketBits;
+    }
+}
+
+bool
+BodyPropagationLossModel::BuildBodyMobilityBuckets(uint32_t bucketBits)
+{
+    m_bodyMobilitySlotShift = 64 - bucketBits;
+    m_bodyMobilitySlots.assign((uint64_t{1} << bucketBits) * BODY_BUCKET_WIDTH, nullptr);
+    for (const MobilityModel* registered : m_bodyMobility)
+    {
+        const MobilityModel** bucket =
+            &m_bodyMobilitySlots[(HashBodyMobility(registered) >> m_bodyMobilitySlotShift) * BODY_BUCKET_WIDTH];
+        uint32_t used = 0;
+        while (used < BODY_BUCKET_WIDTH && bucket[used])
+        {
+            ++used;
+        }
+        if (used == BODY_BUCKET_WIDTH)
+        {
+            return false;
+        }
+        bucket[used] = registered;
+    }
+    return true;
 }
 
 void
 BodyPropagationLossModel::ClearBodyMobility()
 {
     m_bodyMobility.clear();
+    m_bodyMobilitySlots.assign(2 * BODY_BUCKET_WIDTH, nullptr);
+    m_bodyMobilitySlotShift = 63;
     m_useSelectiveAttenuation = false;
 }
 
+uint64_t
+BodyPropagationLossModel::HashBodyMobility(const MobilityModel* mobility)
+{
+    // Fibonacci hashing of the address; the low bits are alignment and carry no information.
+    auto address = static_cast<uint64_t>(reinterpret_cast<uintptr_t>(mobility));
+    return (address >> 4) * 0x9E3779B97F4A7C15ULL;
+}
+
 bool
-BodyPropagationLossModel::ShouldApplyBodyLoss(Ptr<MobilityModel> a, Ptr<MobilityModel> b) const
+BodyPropagationLossModel::IsBodyMobility(const MobilityModel* mobility) const
 {
-    if (!m_useSelectiveAttenuation)
+    const MobilityModel* const* bucket =
+        &m_bodyMobilitySlots[(HashBodyMobility(mobility) >> m_bodyMobilitySlotShift) * BODY_BUCKET_WIDTH];
+    // bitwise | and &: every slot is compared, no early exit; empty slots are null, so a null
+    // mobility must not count as a match
+    bool found = false;
+    for (uint32_t i = 0; i < BODY_BUCKET_WIDTH; ++i)
     {
-        return true;
+        found |= bucket[i] == mobility;
     }
+    return found & (mobility != nullptr);
+}
+
+bool
+BodyPropagationLossModel::ShouldApplyBodyLoss(Ptr<MobilityModel> a, Ptr<MobilityModel> b) const
+{
+    // Without registered models every link crosses the body. The table then holds only empty
+    // slots, so both tests are false and the result is decided by the first operand.
+    return !m_useSelectiveAttenuation | IsBodyMobility(PeekPointer(a)) | IsBodyMobility(PeekPointer(b));
+}
+
+void
+BodyPropagationLossModel::UpdateBodyLoss()
+{
+    const DielectricRow& row = GetDielectricRows()[static_cast<uint32_t>(m_bodyOption)];
+
+    double organDb = row.organDb;
+    double skinDb = row.skinDb;
+    double muscleDb = row.muscleDb * m_parameters.muscleLayer;
+    double fatDb = row.fatDb * m_parameters.fatLayer;
+    double totalDb = 0;
+
+    NS_LOG_DEBUG("layer of fat = " << row.parameters.fatLayer * m_parameters.fatLayer
+                                   << " & layer of muscle = "
+                                   << row.parameters.muscleLayer * m_parameters.muscleLayer);
+    // for testing purpose
+    NS_LOG_DEBUG("organ loss = " << organDb);
+    NS_LOG_DEBUG("muscle loss = " << muscleDb);
+    NS_LOG_DEBUG("fat loss = " << fatDb);
+    NS_LOG_DEBUG("skin loss = " << skinDb);
 
-    const MobilityModel* mobilityA = a ? PeekPointer(a) : nullptr;
-    const MobilityModel* mobilityB = b ? PeekPointer(b) : nullptr;
+    totalDb = organDb + skinDb + fatDb + muscleDb;
+
+    NS_LOG_DEBUG("loss due to body  in db is = " << totalDb);
 
-    return (m_bodyMobility.find(mobilityA) != m_bodyMobility.end() ||
-            m_bodyMobility.find(mobilityB) != m_bodyMobility.end());
+    m_bodyLossDb = totalDb;
 }
 
 double
@@ -253,54 +456,597 @@ BodyPropagationLossModel::DoCalcRxPower(double txPowerDbm,
     {
         return txPowerDbm;
     }
+    if (m_shadowingSigmaDb > 0)
+    {
+        return txPowerDbm - m_bodyLossDb - GetLinkShadowingDb(PeekPointer(a), PeekPointer(b));
+    }
 
-    auto bodyOption = static_cast<uint32_t>(m_bodyOption);
+    return txPowerDbm - m_bodyLossDb;
+}
 
-    double organDb = 0;
-    double skinDb = 0;
-    double muscleDb = 0;
-    double fatDb = 0;
-    double totalDb = 0;
+double
+BodyPropagationLossModel::GetLinkShadowingDb(const MobilityModel* a, const MobilityModel* b) const
+{
+    auto [it, inserted] = m_linkShadowingDb.try_emplace(std::minmax(a, b), 0.0);
+    if (inserted)
+    {
+        it->second = m_shadowingSigmaDb * m_shadowing->GetValue();
+    }
+    return it->second;
+}
 
-    organDb = (520.8 * M_PI * DielectricParameters[bodyOption].organConductivity) /
-              pow(DielectricParameters[bodyOption].organPermittivity, 0.5) *
-              DielectricParameters[bodyOption].organThickness;
+int64_t
+BodyPropagationLossModel::DoAssignStreams(int64_t stream)
+{
+    // NormalRandomVariable generates values in pairs and keeps the second one; SetStream() does
+    // not drop it, so the first draw after a reseed could come from the previous stream. A fresh
+    // variable makes the draws depend only on the run and the stream.
+    m_shadowing = CreateObject<NormalRandomVariable>();
+    m_shadowing->SetAttribute("Mean", DoubleValue(0.0));
+    m_shadowing->SetAttribute("Variance", DoubleValue(1.0));
+    m_shadowing->SetStream(stream);
+    m_linkShadowingDb.clear();
+    return 1;
+}
 
-    muscleDb = (520.8 * M_PI * DielectricParameters[bodyOption].muscleConductivity) /
-               pow(DielectricParameters[bodyOption].musclePermittivity, 0.5) *
-               DielectricParameters[bodyOption].muscleThickness *
-               DielectricParameters[bodyOption].muscleLayer * m_parameters.muscleLayer;
+TypeId
+LinkShadowingPropagationLossModel::GetTypeId()
+{
+    static TypeId tid = TypeId("ns3::LinkShadowingPropagationLossModel")
+                            .SetParent<PropagationLossModel>()
+                            .SetGroupName("Propagation")
+                            .AddConstructor<LinkShadowingPropagationLossModel>()
+                            .AddAttribute("SigmaDb",
+                                          "Standard deviation (dB) of the zero-mean normal "
+                                          "shadowing, drawn once per link until the next "
+                                          "AssignStreams()",
+                                          DoubleValue(0.0),
+                                          MakeDoubleAccessor(&LinkShadowingPropagationLossModel::m_sigmaDb),
+                                          MakeDoubleChecker<double>(0.0));
+    return tid;
+}
 
-    fatDb = (520.8 * M_PI * DielectricParameters[bodyOption].fatConductivity) /
-            pow(DielectricParameters[bodyOption].fatPermittivity, 0.5) *
-            DielectricParameters[bodyOption].fatThickness *
-            DielectricParameters[bodyOption].fatLayer * m_parameters.fatLayer;
+LinkShadowingPropagationLossModel::LinkShadowingPropagationLossModel()
+{
+    m_shadowing = CreateObject<NormalRandomVariable>();
+    m_shadowing->SetAttribute("Mean", DoubleValue(0.0));
+    m_shadowing->SetAttribute("Variance", DoubleValue(1.0));
+}
 
-    skinDb = (520.8 * M_PI * DielectricParameters[bodyOption].skinConductivity) /
-             pow(DielectricParameters[bodyOption].skinPermittivity, 0.5) *
-             DielectricParameters[bodyOption].skinThickness;
+double
+LinkShadowingPropagationLossModel::DoCalcRxPower(double txPowerDbm,
+                                                 Ptr<MobilityModel> a,
+                                                 Ptr<MobilityModel> b) const
+{
+    if (m_sigmaDb <= 0)
+    {
+        return txPowerDbm;
+    }
+    auto [it, inserted] =
+        m_linkShadowingDb.try_emplace(std::minmax(PeekPointer(a), PeekPointer(b)), 0.0);
+    if (inserted)
+    {
+        it->second = m_sigmaDb * m_shadowing->GetValue();
+    }
+    return txPowerDbm - it->second;
+}
 
-    NS_LOG_DEBUG("layer of fat = "
-                 << DielectricParameters[bodyOption].fatLayer * m_parameters.fatLayer
-                 << " & layer of muscle = "
-                 << DielectricParameters[bodyOption].muscleLayer * m_parameters.muscleLayer);
-    // for testing purpose
-    NS_LOG_DEBUG("organ loss = " << organDb);
-    NS_LOG_DEBUG("muscle loss = " << muscleDb);
-    NS_LOG_DEBUG("fat loss = " << fatDb);
-    NS_LOG_DEBUG("skin loss = " << skinDb);
+int64_t
+LinkShadowingPropagationLossModel::DoAssignStreams(int64_t stream)
+{
+    // a fresh variable drops the value cached from the previous stream, see
+    // BodyPropagationLossModel::DoAssignStreams()
+    m_shadowing = CreateObject<NormalRandomVariable>();
+    m_shadowing->SetAttribute("Mean", DoubleValue(0.0));
+    m_shadowing->SetAttribute("Variance", DoubleValue(1.0));
+    m_shadowing->SetStream(stream);
+    m_linkShadowingDb.clear();
+    return 1;
+}
 
-    totalDb = organDb + skinDb + fatDb + muscleDb;
+bool
+TissueDatabase::Load(const std::string& path, std::string& error)
+{
+    std::ifstream in(path);
+    if (!in)
+    {
+        error = "cannot open " + path;
+        return false;
+    }
 
-    NS_LOG_DEBUG("loss due to body  in db is = " << totalDb);
+    std::string line;
+    for (uint32_t lineNumber = 1; std::getline(in, line); ++lineNumber)
+    {
+        line = line.substr(0, line.find('#'));
+        std::istringstream fields(line);
+        std::string record;
+        if (!(fields >> record))
+        {
+            continue;
+        }
+        const std::string where = path + ":" + std::to_string(lineNumber) + ": ";
+
+        std::string name;
+        bool valid = false;
+        if (record == "tissue")
+        {
+            std::string kind;
+            valid = static_cast<bool>(fields >> name >> kind);
+            Tissue& tissue = m_tissues[name];
+            if (valid && kind == "cole-cole")
+            {
+                if (tissue.coleCole || !tissue.points.empty())
+                {
+                    error = where + "tissue " + name + " is already defined";
+                    return false;
+                }
+                valid = static_cast<bool>(fields >> tissue.epsInf >> tissue.sigma);
+                ColeColeTerm term;
+                while (valid && fields >> term.deltaEps)
+                {
+                    valid = static_cast<bool>(fields >> term.tau >> term.alpha) && term.tau > 0 &&
+                            term.alpha >= 0 && term.alpha < 1;
+                    tissue.terms.push_back(term);
+                }
+                valid = valid && fields.eof() && !tissue.terms.empty() && tissue.terms.size() <= 4;
+                tissue.coleCole = true;
+            }
+            else if (valid && kind == "point")
+            {
+                if (tissue.coleCole)
+                {
+                    error = where + "tissue " + name + " is already a cole-cole fit";
+                    return false;
+                }
+                double frequency;
+                double conductivity;
+                double permittivity;
+                valid = static_cast<bool>(fields >> frequency >> conductivity >> permittivity) &&
+                        frequency > 0 && conductivity > 0 && permittivity > 0;
+                tissue.points[frequency] = {conductivity, permittivity};
+            }
+            else
+            {
+                valid = false;
+            }
+        }
+        else if (record == "layer")
+        {
+            double thickness;
+            valid = static_cast<bool>(fields >> name >> thickness) && thickness >= 0 &&
+                    (name == "muscle" || name == "fat" || name == "skin");
+            m_layerThickness[name] = thickness;
+        }
+        else if (record == "organ")
+        {
+            Organ organ;
+            valid = static_cast<bool>(fields >> name >> organ.tissue >> organ.thickness >>
+                                      organ.muscleLayers >> organ.fatLayers >> organ.skinLayers) &&
+                    organ.thickness >= 0 && organ.muscleLayers >= 0 && organ.fatLayers >= 0 &&
+                    organ.skinLayers >= 0;
+            if (organ.tissue == "-")
+            {
+                organ.tissue.clear();
+            }
+            m_organs[name] = organ;
+        }
 
-    return txPowerDbm - totalDb;
+        std::string rest;
+        if (!valid || fields >> rest)
+        {
+            error = where + "invalid record '" + line + "'";
+            return false;
+        }
+    }
+    NS_LOG_DEBUG("loaded " << m_tissues.size() << " tissues and " << m_organs.size()
+                           << " organs from " << path);
+    return true;
 }
 
-int64_t
-BodyPropagationLossModel::DoAssignStreams(int64_t stream)
+bool
+TissueDatabase::HasOrgan(const std::string& name) const
+{
+    return m_organs.count(name) > 0;
+}
+
+bool
+TissueDatabase::GetTissue(const std::string& name,
+                          double frequencyMhz,
+                          double& conductivity,
+                          double& permittivity) const
+{
+    auto it = m_tissues.find(name);
+    if (it == m_tissues.end() || !(frequencyMhz > 0))
+    {
+        return false;
+    }
+    const Tissue& tissue = it->second;
+
+    if (tissue.coleCole)
+    {
+        // complex permittivity eps* = epsInf + sum(deltaEps / (1 + (j w tau)^(1 - alpha)))
+        //                                   + sigma / (j w eps0), conductivity = -Im(eps*) w eps0
+        const double eps0 = 8.8541878128e-12;
+        const double omega = 2 * M_PI * frequencyMhz * 1e6;
+        std::complex<double> eps(tissue.epsInf, -tissue.sigma / (omega * eps0));
+        for (const ColeColeTerm& term : tissue.terms)
+        {
+            eps += term.deltaEps /
+                   (1.0 + std::pow(std::complex<double>(0, omega * term.tau), 1 - term.alpha));
+        }
+        conductivity = -eps.imag() * omega * eps0;
+        permittivity = eps.real();
+        return true;
+    }
+
+    auto upper = tissue.points.lower_bound(frequencyMhz);
+    if (upper == tissue.points.end())
+    {
+        return false;
+    }
+    if (upper->first == frequencyMhz)
+    {
+        conductivity = upper->second.first;
+        permittivity = upper->second.second;
+        return true;
+    }
+    if (upper == tissue.points.begin())
+    {
+        return false;
+    }
+    auto lower = std::prev(upper);
+    const double t = std::log(frequencyMhz / lower->first) / std::log(upper->first / lower->first);
+    conductivity = lower->second.first * std::pow(upper->second.first / lower->second.first, t);
+    permittivity = lower->second.second + t * (upper->second.second - lower->second.second);
+    return true;
+}
+
+bool
+TissueDatabase::Materialize(const std::string& organ,
+                            double frequencyMhz,
+                            BodyDielectricParameters& parameters,
+                            std::string& error) const
+{
+    auto it = m_organs.find(organ);
+    if (it == m_organs.end())
+    {
+        error = "unknown organ " + organ;
+        return false;
+    }
+    const Organ& layout = it->second;
+
+    // Layers that are not on the path get the neutral values of the built-in table.
+    auto layer = [&](const std::string& tissue,
+                     double thickness,
+                     double count,
+                     double& conductivity,
+                     double& permittivity) {
+        conductivity = 1;
+        permittivity = 1;
+        if (count == 0 || thickness == 0)
+        {
+            return true;
+        }
+        if (!GetTissue(tissue, frequencyMhz, conductivity, permittivity))
+        {
+            error = "tissue " + tissue + " has no value at " + std::to_string(frequencyMhz) + " MHz";
+            return false;
+        }
+        return true;
+    };
+    auto thickness = [&](const std::string& name, double count) {
+        auto found = m_layerThickness.find(name);
+        return found == m_layerThickness.end() || count == 0 ? 0.0 : found->second;
+    };
+    if (layout.muscleLayers + layout.fatLayers + layout.skinLayers > 0 &&
+        m_layerThickness.size() < 3)
+    {
+        error = "layer thickness of muscle, fat and skin is required for organ " + organ;
+        return false;
+    }
+
+    parameters.organThickness = layout.tissue.empty() ? 0 : layout.thickness;
+    parameters.muscleThickness = thickness("muscle", layout.muscleLayers);
+    parameters.muscleLayer = layout.muscleLayers;
+    parameters.fatThickness = thickness("fat", layout.fatLayers);
+    parameters.fatLayer = layout.fatLayers;
+    // the table has no skin layer count, the skin is one layer of the total thickness
+    parameters.skinThickness = thickness("skin", layout.skinLayers) * layout.skinLayers;
+    parameters.frequency = frequencyMhz;
+    return layer(layout.tissue,
+                 parameters.organThickness,
+                 1,
+                 parameters.organConductivity,
+                 parameters.organPermittivity) &&
+           layer("muscle",
+                 parameters.muscleThickness,
+                 layout.muscleLayers,
+                 parameters.muscleConductivity,
+                 parameters.musclePermittivity) &&
+           layer("fat",
+                 parameters.fatThickness,
+                 layout.fatLayers,
+                 parameters.fatConductivity,
+                 parameters.fatPermittivity) &&
+           layer("skin",
+                 parameters.skinThickness,
+                 layout.skinLayers,
+                 parameters.skinConductivity,
+                 parameters.skinPermittivity);
+}
+
+namespace
+{
+
+using Parameters = BatchLinkBudget::Parameters;
+
+/**
+ * Per-pair body of LogDistancePropagationLossModel::DoCalcRxPower() followed
+ * by BodyPropagationLossModel::DoCalcRxPower(), in the same operation order.
+ */
+inline double
+ScalarRxPower(const Parameters& p, double txPowerDbm, double dx, double dy, double dz)
+{
+    double distance = std::sqrt(dx * dx + dy * dy + dz * dz);
+    double rxPowerDbm;
+    if (distance <= p.referenceDistance)
+    {
+        rxPowerDbm = txPowerDbm - p.referenceLoss;
+    }
+    else
+    {
+        double pathLossDb = 10 * p.exponent * std::log10(distance / p.referenceDistance);
+        rxPowerDbm = txPowerDbm + (-p.referenceLoss - pathLossDb);
+    }
+    return rxPowerDbm - p.bodyLossDb;
+}
+
+template <bool FIXED_B>
+void
+ScalarKernel(const Parameters& p,
+             double txPowerDbm,
+             PositionArrays a,
+             PositionArrays b,
+             size_t begin,
+             size_t n,
+             double* out)
+{
+    for (size_t i = begin; i < n; ++i)
+    {
+        size_t j = FIXED_B ? 0 : i;
+        out[i] = ScalarRxPower(p, txPowerDbm, a.x[i] - b.x[j], a.y[i] - b.y[j], a.z[i] - b.z[j]);
+    }
+}
+
+#ifdef WBAN_BATCH_X86
+
+// Natural log for positive normal inputs: x = m * 2^e with m folded into
+// [sqrt(0.5), sqrt(2)), ln(m) = 2 atanh(s), s = (m - 1) / (m + 1), |s| < 0.172.
+// The odd series up to s^17 leaves a truncation error below 1e-15.
+constexpr double kLnSeries[] =
+    {1.0 / 17, 1.0 / 15, 1.0 / 13, 1.0 / 11, 1.0 / 9, 1.0 / 7, 1.0 / 5, 1.0 / 3, 1.0};
+
+__attribute__((target("avx2,fma"))) inline __m256d
+LogAvx2(__m256d x)
+{
+    const __m256i bits = _mm256_castpd_si256(x);
+    // biased exponent to double via the 2^52 trick
+    const __m256i magic = _mm256_set1_epi64x(0x4330000000000000LL);
+    __m256d e = _mm256_sub_pd(
+        _mm256_castsi256_pd(_mm256_or_si256(_mm256_srli_epi64(bits, 52), magic)),
+        _mm256_set1_pd(4503599627370496.0 + 1023.0));
+    __m256d m = _mm256_castsi256_pd(
+        _mm256_or_si256(_mm256_and_si256(bits, _mm256_set1_epi64x(0x000FFFFFFFFFFFFFLL)),
+                        _mm256_set1_epi64x(0x3FF0000000000000LL)));
+    const __m256d big = _mm256_cmp_pd(m, _mm256_set1_pd(M_SQRT2), _CMP_GT_OQ);
+    m = _mm256_blendv_pd(m, _mm256_mul_pd(m, _mm256_set1_pd(0.5)), big);
+    e = _mm256_add_pd(e, _mm256_and_pd(big, _mm256_set1_pd(1.0)));
+
+    const __m256d one = _mm256_set1_pd(1.0);
+    const __m256d s = _mm256_div_pd(_mm256_sub_pd(m, one), _mm256_add_pd(m, one));
+    const __m256d s2 = _mm256_mul_pd(s, s);
+    __m256d poly = _mm256_set1_pd(kLnSeries[0]);
+    for (size_t k = 1; k < sizeof(kLnSeries) / sizeof(kLnSeries[0]); ++k)
+    {
+        poly = _mm256_fmadd_pd(poly, s2, _mm256_set1_pd(kLnSeries[k]));
+    }
+    return _mm256_fmadd_pd(e, _mm256_set1_pd(M_LN2), _mm256_mul_pd(_mm256_add_pd(s, s), poly));
+}
+
+template <bool FIXED_B>
+__attribute__((target("avx2,fma"))) void
+Avx2Kernel(const Parameters& p, double txPowerDbm, PositionArrays a, PositionArrays b, size_t n, double* out)
+{
+    const __m256d refDistance = _mm256_set1_pd(p.referenceDistance);
+    const __m256d invRefDistance = _mm256_set1_pd(1.0 / p.referenceDistance);
+    const __m256d slope = _mm256_set1_pd(10 * p.exponent / M_LN10);
+    const __m256d baseDbm = _mm256_set1_pd(txPowerDbm - p.referenceLoss - p.bodyLossDb);
+    __m256d bx = _mm256_set1_pd(b.x[0]);
+    __m256d by = _mm256_set1_pd(b.y[0]);
+    __m256d bz = _mm256_set1_pd(b.z[0]);
+
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4)
+    {
+        if (!FIXED_B)
+        {
+            bx = _mm256_loadu_pd(b.x + i);
+            by = _mm256_loadu_pd(b.y + i);
+            bz = _mm256_loadu_pd(b.z + i);
+        }
+        const __m256d dx = _mm256_sub_pd(_mm256_loadu_pd(a.x + i), bx);
+        const __m256d dy = _mm256_sub_pd(_mm256_loadu_pd(a.y + i), by);
+        const __m256d dz = _mm256_sub_pd(_mm256_loadu_pd(a.z + i), bz);
+        const __m256d distance = _mm256_sqrt_pd(
+            _mm256_fmadd_pd(dz, dz, _mm256_fmadd_pd(dy, dy, _mm256_mul_pd(dx, dx))));
+        const __m256d far = _mm256_cmp_pd(distance, refDistance, _CMP_GT_OQ);
+        // pairs inside the reference distance get log(1) = 0
+        const __m256d ratio = _mm256_blendv_pd(_mm256_set1_pd(1.0),
+                                               _mm256_mul_pd(distance, invRefDistance),
+                                               far);
+        const __m256d rx = _mm256_fnmadd_pd(slope, LogAvx2(ratio), baseDbm);
+        _mm256_storeu_pd(out + i, rx);
+    }
+    ScalarKernel<FIXED_B>(p, txPowerDbm, a, b, i, n, out);
+}
+
+template <bool FIXED_B>
+__attribute__((target("avx512f"))) void
+Avx512Kernel(const Parameters& p,
+             double txPowerDbm,
+             PositionArrays a,
+             PositionArrays b,
+             size_t n,
+             double* out)
+{
+    const __m512d refDistance = _mm512_set1_pd(p.referenceDistance);
+    const __m512d invRefDistance = _mm512_set1_pd(1.0 / p.referenceDistance);
+    const __m512d slope = _mm512_set1_pd(10 * p.exponent / M_LN10);
+    const __m512d baseDbm = _mm512_set1_pd(txPowerDbm - p.referenceLoss - p.bodyLossDb);
+    const __m512d one = _mm512_set1_pd(1.0);
+    // The zero-masked forms with a full mask are used below because the unmasked
+    // intrinsics trip -Wmaybe-uninitialized inside GCC 12 headers.
+    const __mmask8 all = 0xFF;
+    __m512d bx = _mm512_set1_pd(b.x[0]);
+    __m512d by = _mm512_set1_pd(b.y[0]);
+    __m512d bz = _mm512_set1_pd(b.z[0]);
+
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8)
+    {
+        if (!FIXED_B)
+        {
+            bx = _mm512_loadu_pd(b.x + i);
+            by = _mm512_loadu_pd(b.y + i);
+            bz = _mm512_loadu_pd(b.z + i);
+        }
+        const __m512d dx = _mm512_sub_pd(_mm512_loadu_pd(a.x + i), bx);
+        const __m512d dy = _mm512_sub_pd(_mm512_loadu_pd(a.y + i), by);
+        const __m512d dz = _mm512_sub_pd(_mm512_loadu_pd(a.z + i), bz);
+        const __m512d distance = _mm512_maskz_sqrt_pd(
+            all,
+            _mm512_fmadd_pd(dz, dz, _mm512_fmadd_pd(dy, dy, _mm512_mul_pd(dx, dx))));
+        const __mmask8 far = _mm512_cmp_pd_mask(distance, refDistance, _CMP_GT_OQ);
+        const __m512d ratio = _mm512_mask_mul_pd(one, far, distance, invRefDistance);
+
+        // ratio = m * 2^e with m in [1, 2), then m folded into [sqrt(0.5), sqrt(2))
+        __m512d e = _mm512_maskz_getexp_pd(all, ratio);
+        __m512d m = _mm512_maskz_getmant_pd(all, ratio, _MM_MANT_NORM_1_2, _MM_MANT_SIGN_zero);
+        const __mmask8 big = _mm512_cmp_pd_mask(m, _mm512_set1_pd(M_SQRT2), _CMP_GT_OQ);
+        m = _mm512_mask_mul_pd(m, big, m, _mm512_set1_pd(0.5));
+        e = _mm512_mask_add_pd(e, big, e, one);
+        const __m512d s = _mm512_div_pd(_mm512_sub_pd(m, one), _mm512_add_pd(m, one));
+        const __m512d s2 = _mm512_mul_pd(s, s);
+        __m512d poly = _mm512_set1_pd(kLnSeries[0]);
+        for (size_t k = 1; k < sizeof(kLnSeries) / sizeof(kLnSeries[0]); ++k)
+        {
+            poly = _mm512_fmadd_pd(poly, s2, _mm512_set1_pd(kLnSeries[k]));
+        }
+        const __m512d ln = _mm512_fmadd_pd(e,
+                                           _mm512_set1_pd(M_LN2),
+                                           _mm512_mul_pd(_mm512_add_pd(s, s), poly));
+        _mm512_storeu_pd(out + i, _mm512_fnmadd_pd(slope, ln, baseDbm));
+    }
+    ScalarKernel<FIXED_B>(p, txPowerDbm, a, b, i, n, out);
+}
+
+#endif
+
+template <bool FIXED_B>
+void
+RunKernel(BatchLinkBudget::Kernel kernel,
+          const Parameters& p,
+          double txPowerDbm,
+          PositionArrays a,
+          PositionArrays b,
+          size_t n,
+          double* out)
+{
+    switch (kernel)
+    {
+#ifdef WBAN_BATCH_X86
+    case BatchLinkBudget::Kernel::AVX512:
+        Avx512Kernel<FIXED_B>(p, txPowerDbm, a, b, n, out);
+        return;
+    case BatchLinkBudget::Kernel::AVX2:
+        Avx2Kernel<FIXED_B>(p, txPowerDbm, a, b, n, out);
+        return;
+#endif
+    default:
+        ScalarKernel<FIXED_B>(p, txPowerDbm, a, b, 0, n, out);
+        return;
+    }
+}
+
+} // namespace
+
+BatchLinkBudget::BatchLinkBudget(Ptr<LogDistancePropagationLossModel> pathLoss, double bodyLossDb)
+    : m_kernel(GetBestKernel())
+{
+    DoubleValue referenceDistance;
+    DoubleValue referenceLoss;
+    pathLoss->GetAttribute("ReferenceDistance", referenceDistance);
+    pathLoss->GetAttribute("ReferenceLoss", referenceLoss);
+    m_parameters.exponent = pathLoss->GetPathLossExponent();
+    m_parameters.referenceDistance = referenceDistance.Get();
+    m_parameters.referenceLoss = referenceLoss.Get();
+    m_parameters.bodyLossDb = bodyLossDb;
+}
+
+void
+BatchLinkBudget::CalcRxPower(double txPowerDbm,
+                             PositionArrays a,
+                             PositionArrays b,
+                             size_t n,
+                             double* rxPowerDbm) const
+{
+    RunKernel<false>(m_kernel, m_parameters, txPowerDbm, a, b, n, rxPowerDbm);
+}
+
+void
+BatchLinkBudget::CalcRxPower(double txPowerDbm,
+                             PositionArrays a,
+                             const Vector& b,
+                             size_t n,
+                             double* rxPowerDbm) const
+{
+    PositionArrays single{&b.x, &b.y, &b.z};
+    RunKernel<true>(m_kernel, m_parameters, txPowerDbm, a, single, n, rxPowerDbm);
+}
+
+void
+BatchLinkBudget::SetKernel(Kernel kernel)
+{
+    m_kernel = std::min(kernel, GetBestKernel());
+    NS_LOG_DEBUG("batch link budget kernel = " << static_cast<int>(m_kernel));
+}
+
+BatchLinkBudget::Kernel
+BatchLinkBudget::GetKernel() const
+{
+    return m_kernel;
+}
+
+BatchLinkBudget::Kernel
+BatchLinkBudget::GetBestKernel()
 {
-    return 0;
+#ifdef WBAN_BATCH_X86
+    static const Kernel best = [] {
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx512f"))
+        {
+            return Kernel::AVX512;
+        }
+        if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma"))
+        {
+            return Kernel::AVX2;
+        }
+        return Kernel::SCALAR;
+    }();
+    return best;
+#else
+    return Kernel::SCALAR;
+#endif
 }
 } // namespace wban
 } // namespace ns3
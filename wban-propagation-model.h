@@ -12,9 +12,14 @@
 #include "ns3/object.h"
 #include "ns3/propagation-loss-model.h"
 #include "ns3/random-variable-stream.h"
+#include "ns3/vector.h"
 
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <string>
 #include <unordered_map>
-#include <unordered_set>
+#include <vector>
 
 namespace ns3
 {
@@ -84,6 +89,30 @@ class BodyPropagationLossModel : public PropagationLossModel
 
     BodyPropagationLossModel();
 
+    /// Number of rows of the built-in dielectric table (the values of BodyOrganOption).
+    static constexpr uint32_t BUILTIN_BODY_OPTIONS = 13;
+
+    /**
+     * Append a row to the dielectric table shared by all instances. The
+     * attenuation terms that do not depend on the layer counts are computed
+     * once here, so SetBodyOptions() with the returned option is a table
+     * lookup. Rows are meant to be added at startup, before any simulation
+     * runs; the table is not synchronized.
+     *
+     * @param parameters the dielectric row, e.g. from TissueDatabase::Materialize()
+     * @return the option selecting the new row (past the built-in values)
+     */
+    static BodyOrganOption AddBodyOption(const BodyDielectricParameters& parameters);
+    /**
+     * @return number of rows in the dielectric table, built-in and added
+     */
+    static uint32_t GetBodyOptionCount();
+    /**
+     * @param bodyOption a built-in or added option
+     * @return the dielectric row selected by the option
+     */
+    static const BodyDielectricParameters& GetDielectricParameters(BodyOrganOption bodyOption);
+
     // Delete copy constructor and assignment operator to avoid misuse
     BodyPropagationLossModel(const BodyPropagationLossModel&) = delete;
     BodyPropagationLossModel& operator=(const BodyPropagationLossModel&) = delete;
@@ -132,6 +161,21 @@ class BodyPropagationLossModel : public PropagationLossModel
      * @return The number of muscle layers
      */
     uint32_t GetMuscleLayer() const;
+    /**
+     * Get the total attenuation (organ, muscle, fat and skin) applied to
+     * links that cross the body, for the current configuration.
+     * @return the body loss in dB
+     */
+    double GetBodyLossDb() const;
+    /**
+     * Get the mean attenuation of the link between two mobility models:
+     * GetBodyLossDb() if the link crosses the body, 0 otherwise. Unlike
+     * CalcRxPower() it draws no shadowing sample.
+     * @param a one end of the link
+     * @param b the other end of the link
+     * @return the body loss of the link in dB
+     */
+    double GetLinkBodyLossDb(Ptr<MobilityModel> a, Ptr<MobilityModel> b) const;
 
     /**
      * Mark a mobility model as residing inside the body volume.
@@ -165,8 +209,310 @@ class BodyPropagationLossModel : public PropagationLossModel
 
     bool ShouldApplyBodyLoss(Ptr<MobilityModel> a, Ptr<MobilityModel> b) const;
 
+    /**
+     * Recompute m_bodyLossDb from the dielectric table and the configured
+     * layer counts. Called whenever the organ or a layer count changes, so
+     * DoCalcRxPower() only subtracts the cached value.
+     */
+    void UpdateBodyLoss();
+
+    /**
+     * Hash of a mobility model address used by the membership table.
+     * @param mobility the mobility model (may be null)
+     * @return 64-bit hash; the top bits index the bucket
+     */
+    static uint64_t HashBodyMobility(const MobilityModel* mobility);
+
+    /**
+     * Branch-free exact membership test: one bucket of BODY_BUCKET_WIDTH
+     * slots is compared with the address.
+     * @param mobility the mobility model (may be null)
+     * @return true if the model was registered with AddBodyMobility()
+     */
+    bool IsBodyMobility(const MobilityModel* mobility) const;
+
+    /**
+     * Place all registered models into 2^bucketBits buckets.
+     * @param bucketBits log2 of the bucket count
+     * @return false if a bucket would hold more than BODY_BUCKET_WIDTH models
+     */
+    bool BuildBodyMobilityBuckets(uint32_t bucketBits);
+
+    /**
+     * Shadowing of the link between a and b: drawn once per link and kept
+     * until the next AssignStreams().
+     * @param a one end of the link
+     * @param b the other end of the link
+     * @return the shadowing in dB
+     */
+    double GetLinkShadowingDb(const MobilityModel* a, const MobilityModel* b) const;
+
+    static constexpr uint32_t BODY_BUCKET_WIDTH = 4; //!< slots per bucket
+
+    double m_bodyLossDb = 0; //!< cached total body attenuation in dB
+    double m_shadowingSigmaDb = 0;          //!< standard deviation of the body shadowing in dB
+    Ptr<NormalRandomVariable> m_shadowing;  //!< standard normal draws for the body shadowing
+    mutable std::map<std::pair<const MobilityModel*, const MobilityModel*>, double>
+        m_linkShadowingDb; //!< body shadowing drawn for each link since the last AssignStreams()
     bool m_useSelectiveAttenuation = false;
-    std::unordered_set<const MobilityModel*> m_bodyMobility;
+    /**
+     * Registered in-body mobility models. m_bodyMobilitySlots holds them in
+     * buckets of BODY_BUCKET_WIDTH addresses indexed by the top bits of the
+     * hash; AddBodyMobility() doubles the bucket count until no bucket
+     * overflows, so a lookup never probes past its bucket and a link test is
+     * a fixed number of loads and compares.
+     */
+    std::vector<const MobilityModel*> m_bodyMobility;
+    std::vector<const MobilityModel*> m_bodyMobilitySlots =
+        std::vector<const MobilityModel*>(2 * BODY_BUCKET_WIDTH, nullptr); //!< bucketed address table
+    uint32_t m_bodyMobilitySlotShift = 63;                                 //!< 64 - log2(bucket count)
+};
+
+/**
+ * @class LinkShadowingPropagationLossModel
+ * @brief Zero-mean normal shadowing drawn once per link.
+ *
+ * Unlike RandomPropagationLossModel, which draws a new value on every call,
+ * the value of each link (an unordered pair of mobility models) is drawn on
+ * its first use and kept until the next AssignStreams(). Every packet of a
+ * link then sees the same slow fading, so averaging over packets does not
+ * remove its variance.
+ */
+class LinkShadowingPropagationLossModel : public PropagationLossModel
+{
+  public:
+    /**
+     * @brief Get the type ID.
+     * @return the object TypeId
+     */
+    static TypeId GetTypeId();
+
+    LinkShadowingPropagationLossModel();
+
+  private:
+    double DoCalcRxPower(double txPowerDbm,
+                         Ptr<MobilityModel> a,
+                         Ptr<MobilityModel> b) const override;
+
+    int64_t DoAssignStreams(int64_t stream) override;
+
+    double m_sigmaDb = 0;                  //!< standard deviation of the shadowing in dB
+    Ptr<NormalRandomVariable> m_shadowing; //!< standard normal draws
+    mutable std::map<std::pair<const MobilityModel*, const MobilityModel*>, double>
+        m_linkShadowingDb; //!< shadowing drawn for each link since the last AssignStreams()
+};
+
+/**
+ * @class TissueDatabase
+ * @brief Dielectric properties of tissues over frequency, loaded from a text file.
+ *
+ * Each line of the file is one record, fields are separated by whitespace and
+ * '#' starts a comment:
+ *
+ *     tissue <name> cole-cole <epsInf> <sigma S/m> <deltaEps> <tau s> <alpha> ...
+ *     tissue <name> point <frequency MHz> <conductivity S/m> <permittivity>
+ *     layer <muscle|fat|skin> <thickness m>
+ *     organ <name> <tissue|-> <thickness m> <muscle layers> <fat layers> <skin layers>
+ *
+ * A cole-cole record gives up to four dispersion terms (deltaEps, tau, alpha)
+ * of the Cole-Cole model. A tissue given by point records is interpolated
+ * between the two nearest frequencies, linearly in log(frequency) for the
+ * permittivity and in log(frequency)/log(conductivity) for the conductivity;
+ * frequencies outside the listed range are rejected. A tissue is described
+ * either by one cole-cole record or by point records.
+ *
+ * An organ record describes the path of BodyPropagationLossModel: the organ
+ * tissue (or '-' for none) and the numbers of muscle, fat and skin layers of
+ * the thickness given by the layer records.
+ */
+class TissueDatabase
+{
+  public:
+    /**
+     * Read records from a file, adding them to the ones already loaded.
+     * @param path the file to read
+     * @param error set to a description of the first invalid record
+     * @return false if the file cannot be read or a record is invalid
+     */
+    bool Load(const std::string& path, std::string& error);
+
+    /**
+     * @param name the organ name of an organ record
+     * @return true if the organ was loaded
+     */
+    bool HasOrgan(const std::string& name) const;
+
+    /**
+     * Evaluate a tissue at a frequency.
+     * @param name the tissue name
+     * @param frequencyMhz the frequency in MHz
+     * @param conductivity set to the conductivity in S/m
+     * @param permittivity set to the relative permittivity
+     * @return false if the tissue is unknown or the frequency is outside its points
+     */
+    bool GetTissue(const std::string& name,
+                   double frequencyMhz,
+                   double& conductivity,
+                   double& permittivity) const;
+
+    /**
+     * Build the dielectric row of an organ at a frequency, in the layout of
+     * the built-in table.
+     * @param organ the organ name
+     * @param frequencyMhz the frequency in MHz
+     * @param parameters the resulting row
+     * @param error set to the reason of a failure
+     * @return false if the organ or one of its tissues cannot be evaluated
+     */
+    bool Materialize(const std::string& organ,
+                     double frequencyMhz,
+                     BodyDielectricParameters& parameters,
+                     std::string& error) const;
+
+  private:
+    /**
+     * One dispersion term of the Cole-Cole model.
+     */
+    struct ColeColeTerm
+    {
+        double deltaEps; //!< permittivity step
+        double tau;      //!< relaxation time in s
+        double alpha;    //!< broadening of the dispersion
+    };
+
+    /**
+     * A tissue, either a Cole-Cole fit or measured points.
+     */
+    struct Tissue
+    {
+        bool coleCole = false;            //!< true if the fit below is used
+        double epsInf = 0;                //!< permittivity at high frequency
+        double sigma = 0;                 //!< static ionic conductivity in S/m
+        std::vector<ColeColeTerm> terms;  //!< dispersion terms
+        std::map<double, std::pair<double, double>> points; //!< MHz -> conductivity, permittivity
+    };
+
+    /**
+     * Layer layout of an organ record.
+     */
+    struct Organ
+    {
+        std::string tissue;    //!< organ tissue, empty for none
+        double thickness;      //!< organ thickness in m
+        double muscleLayers;   //!< number of muscle layers
+        double fatLayers;      //!< number of fat layers
+        double skinLayers;     //!< number of skin layers
+    };
+
+    std::map<std::string, Tissue> m_tissues;          //!< tissues by name
+    std::map<std::string, double> m_layerThickness;   //!< muscle, fat and skin layer thickness
+    std::map<std::string, Organ> m_organs;            //!< organs by name
+};
+
+/**
+ * Structure-of-arrays view of positions, coordinates in m.
+ */
+struct PositionArrays
+{
+    const double* x; //!< x coordinates
+    const double* y; //!< y coordinates
+    const double* z; //!< z coordinates
+};
+
+/**
+ * @class BatchLinkBudget
+ * @brief Evaluates the log-distance path loss followed by a fixed body loss
+ * for many position pairs at once, without mobility models.
+ *
+ * The parameters of the LogDistancePropagationLossModel are copied at
+ * construction. The body loss is passed explicitly, because batched
+ * positions carry no in-body registration: use
+ * BodyPropagationLossModel::GetBodyLossDb() for links that cross the body
+ * and 0 for the others.
+ *
+ * The SCALAR kernel uses the same expressions as the per-call models and
+ * gives identical results. The AVX2 and AVX512 kernels use their own log
+ * and reciprocal; they differ from the per-call results by at most
+ * BatchLinkBudget::TOLERANCE_DB.
+ */
+class BatchLinkBudget
+{
+  public:
+    /**
+     * Implementation used by CalcRxPower().
+     */
+    enum class Kernel
+    {
+        SCALAR = 0,
+        AVX2 = 1,  //!< 4 pairs per step, requires AVX2 and FMA
+        AVX512 = 2 //!< 8 pairs per step, requires AVX-512F
+    };
+
+    /// Maximum absolute difference in dB between any kernel and per-call CalcRxPower().
+    static constexpr double TOLERANCE_DB = 1e-9;
+
+    /**
+     * @param pathLoss the log-distance model whose parameters are used
+     * @param bodyLossDb attenuation subtracted after the path loss, in dB
+     */
+    BatchLinkBudget(Ptr<LogDistancePropagationLossModel> pathLoss, double bodyLossDb);
+
+    /**
+     * Compute rx power for n pairs (a[i], b[i]).
+     * @param txPowerDbm the transmit power in dBm
+     * @param a transmitter positions
+     * @param b receiver positions
+     * @param n number of pairs
+     * @param rxPowerDbm output array of n values
+     */
+    void CalcRxPower(double txPowerDbm,
+                     PositionArrays a,
+                     PositionArrays b,
+                     size_t n,
+                     double* rxPowerDbm) const;
+    /**
+     * Compute rx power for n transmitters a[i] and a single receiver b.
+     * @param txPowerDbm the transmit power in dBm
+     * @param a transmitter positions
+     * @param b the receiver position
+     * @param n number of transmitters
+     * @param rxPowerDbm output array of n values
+     */
+    void CalcRxPower(double txPowerDbm,
+                     PositionArrays a,
+                     const Vector& b,
+                     size_t n,
+                     double* rxPowerDbm) const;
+
+    /**
+     * Force a kernel. Kernels not supported by the CPU fall back to the best
+     * supported one.
+     * @param kernel the requested kernel
+     */
+    void SetKernel(Kernel kernel);
+    /**
+     * @return the kernel used by CalcRxPower()
+     */
+    Kernel GetKernel() const;
+    /**
+     * @return the widest kernel supported by the CPU
+     */
+    static Kernel GetBestKernel();
+
+    /**
+     * Parameters shared by all kernels.
+     */
+    struct Parameters
+    {
+        double exponent;          //!< path loss exponent
+        double referenceDistance; //!< reference distance in m
+        double referenceLoss;     //!< loss at the reference distance in dB
+        double bodyLossDb;        //!< loss added to every pair in dB
+    };
+
+  private:
+    Parameters m_parameters; //!< snapshot of the model parameters
+    Kernel m_kernel;         //!< selected kernel
 };
 
 } // namespace wban